@@ -0,0 +1,125 @@
+/**
+* @file
+* @brief Clock system setup and the timing constants derived from it
+*
+* Header only, shared by the three firmwares. F_CPU is the one clock rate
+* every delay, timer period and baud divider is worked out from at compile
+* time: MCLK and SMCLK both run at F_CPU from the DCO, which the FLL locks
+* to REFO, and ACLK is REFO. Set F_CPU in a project's predefined symbols to
+* change it; 1, 2, 4, 8, 12, 16 MHz work everywhere, 20 and 24 MHz on the
+* FR2355 only.
+*/
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+#include <msp430.h>
+#include "intrinsics.h"
+
+#ifndef F_CPU
+#define F_CPU       16000000UL
+#endif
+#define F_SMCLK     F_CPU
+#define F_ACLK      32768UL             // REFO
+
+#if (F_CPU % 1000000UL) != 0
+#error "F_CPU must be a whole number of MHz"
+#elif F_CPU > 24000000UL
+#error "F_CPU above 24 MHz"
+#elif (F_CPU > 16000000UL) && defined(__MSP430FR2310__)
+#error "the FR2310 runs at 16 MHz at most"
+#endif
+
+// DCO range holding F_CPU, and the FLL multiplier from REFO: DCOCLKDIV = (FLLN + 1) * 32768
+#if F_CPU <= 1000000UL
+#define CLOCK_DCORSEL   DCORSEL_0
+#elif F_CPU <= 2000000UL
+#define CLOCK_DCORSEL   DCORSEL_1
+#elif F_CPU <= 4000000UL
+#define CLOCK_DCORSEL   DCORSEL_2
+#elif F_CPU <= 8000000UL
+#define CLOCK_DCORSEL   DCORSEL_3
+#elif F_CPU <= 12000000UL
+#define CLOCK_DCORSEL   DCORSEL_4
+#elif F_CPU <= 16000000UL
+#define CLOCK_DCORSEL   DCORSEL_5
+#elif F_CPU <= 20000000UL
+#define CLOCK_DCORSEL   DCORSEL_6
+#else
+#define CLOCK_DCORSEL   DCORSEL_7
+#endif
+#define CLOCK_FLLN      ((F_CPU + (F_ACLK / 2)) / F_ACLK - 1)
+
+// FRAM reads take a wait state for every 8 MHz of MCLK past the first 8
+#if F_CPU > 16000000UL
+#define CLOCK_NWAITS    NWAITS_2
+#elif F_CPU > 8000000UL
+#define CLOCK_NWAITS    NWAITS_1
+#else
+#define CLOCK_NWAITS    NWAITS_0
+#endif
+
+// busy waits; the argument must be a constant
+#define DELAY_US(us)    __delay_cycles((unsigned long)(us) * (F_CPU / 1000000UL))
+#define DELAY_MS(ms)    __delay_cycles((unsigned long)(ms) * (F_CPU / 1000UL))
+
+// Timer_B on SMCLK / 8, for periods of milliseconds
+// Math: n ms = (8 / F_SMCLK)(TIMER_MS(n))
+#define TIMER_MS(ms)    ((uint16_t)((F_SMCLK / 8000UL) * (ms)))
+
+// Timer_B on ACLK, which keeps counting in LPM3; one period of an hz tick
+// rate, rounded to the nearest count
+// Math: 1/hz s = (1 / F_ACLK)(ACLK_TICKS(hz))
+#define ACLK_TICKS(hz)  ((uint16_t)((F_ACLK + (hz) / 2) / (hz)))
+#define ACLK_MS(ms)     ((uint16_t)((F_ACLK * (ms) + 500UL) / 1000UL))     // up to 2 s
+
+// Timer_B ID and IDEX dividers that bring SMCLK down to 1 MHz, for microsecond timestamps:
+// the largest ID that leaves a whole IDEX of 1-8, e.g. 12 MHz = 4 * 3, 20 MHz = 4 * 5
+#define TIMER_US_MHZ    (F_SMCLK / 1000000UL)
+#if ((TIMER_US_MHZ % 8) == 0) && (TIMER_US_MHZ <= 64)
+#define TIMER_US_ID     ID__8
+#define TIMER_US_IDEX   ((TIMER_US_MHZ / 8) - 1)
+#elif ((TIMER_US_MHZ % 4) == 0) && (TIMER_US_MHZ <= 32)
+#define TIMER_US_ID     ID__4
+#define TIMER_US_IDEX   ((TIMER_US_MHZ / 4) - 1)
+#elif ((TIMER_US_MHZ % 2) == 0) && (TIMER_US_MHZ <= 16)
+#define TIMER_US_ID     ID__2
+#define TIMER_US_IDEX   ((TIMER_US_MHZ / 2) - 1)
+#elif TIMER_US_MHZ <= 8
+#define TIMER_US_ID     ID__1
+#define TIMER_US_IDEX   (TIMER_US_MHZ - 1)
+#else
+#error "no Timer_B divider brings F_SMCLK to 1 MHz"
+#endif
+
+// eUSCI_B I2C master SCL divider
+#define I2C_BRW(hz)     ((uint16_t)((F_SMCLK + (hz) - 1) / (hz)))   // rounded up: never faster than asked
+
+// ADC clock divider keeping ADCCLK at 5 MHz or less
+#define ADC_DIV         ((F_SMCLK + 4999999UL) / 5000000UL)
+#define CLOCK_ADCDIV    ((ADC_DIV - 1) << 5)
+
+/**
+* runs MCLK and SMCLK at F_CPU from the FLL-locked DCO, ACLK from REFO
+*
+* Call first thing after stopping the watchdog; the FRAM wait states go in
+* before the clock goes up.
+*/
+static inline void init_clock()
+{
+    FRCTL0 = FRCTLPW | CLOCK_NWAITS;
+
+    __bis_SR_register(SCG0);            // FLL off while it is set up
+    CSCTL3 = SELREF__REFOCLK;           // FLL reference = REFO
+    CSCTL0 = 0;                         // DCO tap and modulation, the FLL settles them
+    CSCTL1 = CLOCK_DCORSEL;
+    CSCTL2 = FLLD_0 | CLOCK_FLLN;
+    __delay_cycles(3);
+    __bic_SR_register(SCG0);            // FLL on
+    while(CSCTL7 & (FLLUNLOCK0 | FLLUNLOCK1));      // wait for lock
+
+    CSCTL4 = SELMS__DCOCLKDIV | SELA__REFOCLK;      // MCLK, SMCLK = DCOCLKDIV; ACLK = REFO
+    CSCTL5 = DIVM__1 | DIVS__1;
+}
+
+#endif
@@ -0,0 +1,177 @@
+/**
+* @file
+* @brief State shared between ISRs and main, for all three firmwares
+*
+* Header only. Each firmware's CCS project has the repo root on its include
+* path, so this is "common/isr_share.h" everywhere.
+*
+* The MSP430 has one core and ISRs don't nest, so an ISR always runs to
+* completion while main can be stopped anywhere. That is all these rely on:
+*
+* - Ring: bytes from one side to the other. Only the producer moves head and
+*   only the consumer moves tail, both 8 bits, so neither needs a lock.
+* - Events: a bitset posted from anywhere and taken by main, with the
+*   read-modify-write done with interrupts off.
+* - Snapshot: a multi-byte value written by an ISR and read by main. The
+*   reader copies it and tries again if the ISR wrote in the meantime, so
+*   main never holds interrupts off for the copy.
+*/
+#ifndef ISR_SHARE_H
+#define ISR_SHARE_H
+
+#include <stdint.h>
+#include "intrinsics.h"
+
+/**
+* single-producer single-consumer byte ring
+*
+* One slot is kept empty to tell full from empty, so a ring of n bytes
+* holds n - 1.
+*/
+typedef struct {
+    volatile uint8_t *buf;
+    uint8_t mask;                       // size - 1, size a power of 2 up to 256
+    volatile uint8_t head;              // next slot to fill, producer only
+    volatile uint8_t tail;              // next slot to empty, consumer only
+} Ring;
+
+// Ring initializer over a uint8_t array
+#define RING_INIT(storage)  {(storage), (uint8_t)(sizeof(storage) - 1), 0, 0}
+
+/**
+* @return: bytes waiting
+*/
+static inline uint8_t ring_count(const Ring *r)
+{
+    return (uint8_t)(r->head - r->tail) & r->mask;
+}
+
+/**
+* @return: bytes that can be put before the ring is full
+*/
+static inline uint8_t ring_room(const Ring *r)
+{
+    return r->mask - ring_count(r);
+}
+
+/**
+* adds a byte, producer side
+*
+* @return: 1, or 0 if the ring was full
+*/
+static inline uint8_t ring_put(Ring *r, uint8_t byte)
+{
+    uint8_t head = r->head;
+    uint8_t next = (head + 1) & r->mask;
+    if(next == r->tail)
+    {
+        return 0;
+    }
+    r->buf[head] = byte;                // the byte lands before the consumer can see it
+    r->head = next;
+    return 1;
+}
+
+/**
+* removes a byte, consumer side
+*
+* @return: 1, or 0 if the ring was empty
+*/
+static inline uint8_t ring_get(Ring *r, uint8_t *byte)
+{
+    uint8_t tail = r->tail;
+    if(tail == r->head)
+    {
+        return 0;
+    }
+    *byte = r->buf[tail];               // taken before the slot is handed back
+    r->tail = (tail + 1) & r->mask;
+    return 1;
+}
+
+/**
+* event bits, set by anyone and taken by main
+*/
+typedef volatile uint16_t Events;
+
+/**
+* sets event bits; safe from an ISR or main
+*/
+static inline void events_post(Events *e, uint16_t bits)
+{
+    unsigned short int_state = __get_interrupt_state();
+    __disable_interrupt();
+    *e |= bits;
+    __set_interrupt_state(int_state);
+}
+
+/**
+* clears and returns the pending bits in a mask, as one step
+*
+* @param mask: bits to take
+*
+* @return: the ones that were set
+*/
+static inline uint16_t events_take(Events *e, uint16_t mask)
+{
+    unsigned short int_state = __get_interrupt_state();
+    __disable_interrupt();
+    uint16_t bits = *e & mask;
+    *e &= ~bits;
+    __set_interrupt_state(int_state);
+    return bits;
+}
+
+/**
+* a value an ISR writes whole and main reads whole
+*
+* seq is odd while the ISR is part way through a write. A write can't be
+* interrupted by the reader, so only main ever has to retry; never read one
+* from an ISR that could interrupt its writer.
+*/
+typedef struct {
+    volatile uint8_t seq;
+    volatile uint8_t *data;
+    uint8_t size;
+} Snapshot;
+
+// Snapshot initializer over the variable that holds the value
+#define SNAPSHOT_INIT(storage)  {0, (volatile uint8_t *)&(storage), sizeof(storage)}
+
+/**
+* stores a new value, from the ISR that owns it
+*
+* @param value: size bytes
+*/
+static inline void snap_write(Snapshot *s, const void *value)
+{
+    const uint8_t *src = (const uint8_t *)value;
+    uint8_t i;
+    s->seq++;
+    for(i = 0; i < s->size; i++)
+    {
+        s->data[i] = src[i];
+    }
+    s->seq++;
+}
+
+/**
+* copies out the latest whole value, from main
+*
+* @param value: receives size bytes
+*/
+static inline void snap_read(const Snapshot *s, void *value)
+{
+    uint8_t *dst = (uint8_t *)value;
+    uint8_t seq, i;
+    do
+    {
+        seq = s->seq;
+        for(i = 0; i < s->size; i++)
+        {
+            dst[i] = s->data[i];
+        }
+    } while((seq & 1) || (seq != s->seq));
+}
+
+#endif
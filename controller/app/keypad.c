@@ -5,6 +5,7 @@
 */
 #include "../src/keypad.h"
 #include <msp430.h>
+#include "common/clock.h"
 
 // reversed to match datasheet to pin indices
 char key_chars[4][4] = {
@@ -47,7 +48,7 @@ int scan_keypad(Keypad *keypad, char *key_press) {
     for(col = 0; col < 4; col++){
         // clear, set col LOW
         P2OUT &= ~keypad->col_pins[col];
-        __delay_cycles(1000);
+        DELAY_MS(1);
 
         for(row = 0; row < 4; row++){
             if (!(P5IN & keypad->row_pins[row])){
@@ -4,6 +4,7 @@
 *
 */
 #include "src/lcd.h"
+#include "src/trace.h"
 #include "intrinsics.h"
 #include "msp430fr2355.h"
 
@@ -11,12 +12,24 @@
 uint8_t state_flag;         // 0 = just update temp, 1 = pattern, 2 = window
 uint8_t current_temp_digit;
 uint8_t change_allowed;   // flag to tell if the incoming data is allowed to change window size or n
+uint8_t lcd_mode_shown = 3;     // mode on the top row, redrawn after diagnostics
+uint8_t lcd_diag = 0;           // top row shows the load meter instead
 
 char *lcd_strings[] = {
     "heat    ", "cool    ", "match   ", "off     "};
 char ambient_str[] = "A:xx.x";
 char plant_str[] = "P:xx.x";
-char time_n[] = "3 xxxs";
+char time_n[] = "3 mm:ss ";
+char diag_str[] = "cpu  0% -- -- q0";
+
+// binary 0-59 to packed BCD, two display digits per entry
+const uint8_t bcd_table[60] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19,
+    0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29,
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+    0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59};
 
 void init_lcd(){
     P3DIR |= BIT0 | BIT1 | BIT4 | BIT5 | BIT6 | BIT7;       // EN, RS, DB4, DB5, DB6, DB7
@@ -28,7 +41,7 @@ void init_lcd(){
 
     PM5CTL0 &= ~LOCKLPM5;
     
-    __delay_cycles(50000);
+    DELAY_MS(50);
     lcd_set_function();
     DELAY_001;
     lcd_send_command(LCD_DISPLAY_ON);
@@ -69,24 +82,102 @@ void lcd_send_string(char *str){
 
 void send_lcd_mode(uint8_t mode)
 {
+    lcd_mode_shown = mode;
+    if (lcd_diag) {
+        return;                 // drawn when diagnostics are turned off
+    }
+    TRACE(TR_LCD_BEGIN, TR_LCD_PART_MODE);
     lcd_send_command(LCD_RETURN_HOME);
     DELAY_0001;
     lcd_send_string((char*)lcd_strings[mode]);
+    TRACE(TR_LCD_END, TR_LCD_PART_MODE);
+}
+
+void lcd_show_diag(uint8_t on)
+{
+    lcd_diag = 0;
+    if (on) {
+        lcd_send_command(LCD_RETURN_HOME);
+        DELAY_0001;
+        lcd_send_string(diag_str);
+    } else {
+        // put the mode and ambient temperature back
+        send_lcd_mode(lcd_mode_shown);
+        lcd_send_command(0x80 | 0x08);
+        DELAY_0001;
+        lcd_send_string(ambient_str);
+        lcd_send_data(0b11011111);      // degree symbol
+        lcd_send_data('C');
+    }
+    lcd_diag = on;
+}
+
+void lcd_set_diag(uint8_t cpu_pct, const char *isr, uint8_t isr_ms, uint8_t backlog)
+{
+    // "cpu 23% tx 31 q2": load, busiest ISR and its ms in the last second, main loop backlog
+    diag_str[4] = (cpu_pct >= 100) ? '1' : ' ';
+    diag_str[5] = (cpu_pct >= 10) ? ((cpu_pct / 10) % 10) + '0' : ' ';
+    diag_str[6] = (cpu_pct % 10) + '0';
+    diag_str[9] = isr[0];
+    diag_str[10] = isr[1];
+    if (isr_ms > 99) {
+        isr_ms = 99;
+    }
+    diag_str[12] = isr_ms / 10 + '0';
+    diag_str[13] = isr_ms % 10 + '0';
+    diag_str[15] = (backlog > 9) ? '+' : backlog + '0';
+
+    if (lcd_diag) {
+        lcd_send_command(LCD_RETURN_HOME);
+        DELAY_0001;
+        lcd_send_string(diag_str);
+    }
 }
 
-void lcd_set_time(uint8_t *data)
+void lcd_set_time(uint16_t seconds)
 {
+    uint8_t hours = 0, minutes = 0;
+    while (seconds >= 3600 && hours < 9) {
+        seconds -= 3600;
+        hours++;
+    }
+    while (seconds >= 60 && minutes < 59) {
+        seconds -= 60;
+        minutes++;
+    }
+    if (seconds > 59) {
+        seconds = 59;           // clamp at 9:59:59
+    }
+
+    uint8_t mm = bcd_table[minutes];
+    uint8_t ss = bcd_table[seconds];
+    char *field = time_n + 2;   // "3 mm:ss "
+    if (hours) {
+        field = time_n;         // "h:mm:ss " takes over the window label
+        *field++ = hours + '0';
+        *field++ = ':';
+    } else {
+        time_n[0] = '3';
+        time_n[1] = ' ';
+    }
+    *field++ = (mm >> 4) + '0';
+    *field++ = (mm & 0x0F) + '0';
+    *field++ = ':';
+    *field++ = (ss >> 4) + '0';
+    *field++ = (ss & 0x0F) + '0';
+    *field = ' ';
+
     // set DDRAM to bottom left corner
+    TRACE(TR_LCD_BEGIN, TR_LCD_PART_TIME);
     lcd_send_command(LCD_BOTTOM_LINE);       
     DELAY_0001;
-    time_n[2] = data[0] + '0'; // 100 s
-    time_n[3] = data[1] + '0'; // 10 s
-    time_n[4] = data[2] + '0'; // 1 s
     lcd_send_string(time_n);
+    TRACE(TR_LCD_END, TR_LCD_PART_TIME);
 }
 
 void lcd_set_temperature(uint8_t mode, uint8_t *data)
 {    
+    TRACE(TR_LCD_BEGIN, TR_LCD_PART_TEMP);
     if (mode) {
         // plant temp
         lcd_send_command(0x80 | 0x48); // set to ninth address on bottom line
@@ -99,17 +190,19 @@ void lcd_set_temperature(uint8_t mode, uint8_t *data)
         lcd_send_data('C');
         lcd_send_command(LCD_RETURN_HOME);  
     } else {
-        // ambient temp
-        lcd_send_command(0x80 | 0x08);
-        DELAY_0001;
+        // ambient temp, kept for later while diagnostics have the top row
         ambient_str[2] = data[0] + '0';
         ambient_str[3] = data[1] + '0';
         ambient_str[5] = data[2] + '0';
-        lcd_send_string(ambient_str);
-        lcd_send_data(0b11011111);      // degree symbol         
-        lcd_send_data('C');
+        if (!lcd_diag) {
+            lcd_send_command(0x80 | 0x08);
+            DELAY_0001;
+            lcd_send_string(ambient_str);
+            lcd_send_data(0b11011111);      // degree symbol         
+            lcd_send_data('C');
+        }
     }
-             
+    TRACE(TR_LCD_END, TR_LCD_PART_TEMP);
 }
 
 
@@ -120,21 +213,21 @@ void lcd_set_function(){
     DELAY_0001;
     P3OUT &= ~BIT0;
 
-    __delay_cycles(30000);
+    DELAY_MS(30);
 
     P3OUT = (0x03 << 4);            // Send high nibble
     P3OUT |= BIT0;                  // Enable pulse
     DELAY_0001;
     P3OUT &= ~BIT0;
 
-    __delay_cycles(30000);
+    DELAY_MS(30);
 
     P3OUT = (0x03 << 4);          // Send high nibble
     P3OUT |= BIT0;                  // Enable pulse
     DELAY_0001;
     P3OUT &= ~BIT0;
 
-    __delay_cycles(30000);
+    DELAY_MS(30);
 
     P3OUT = (0x02 << 4);    // Send low nibble
     P3OUT |= BIT0;
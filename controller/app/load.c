@@ -0,0 +1,74 @@
+/**
+* @file
+* @brief CPU load meter functionality
+*
+*/
+#include "src/load.h"
+#include "src/profile.h"
+#include "src/uart.h"
+#include "intrinsics.h"
+
+LoadReport load = {0, PROF_VECTORS, 0, 0, 0};
+
+// main only ever adds to these; the window takes the difference since the last one
+volatile uint16_t load_loops = 0;
+uint16_t load_loops_last = 0;
+uint32_t load_window_start = 0;         // sched_clock() when the window opened
+volatile uint8_t load_backlog = 0;
+volatile uint8_t load_asleep = 0;
+volatile uint32_t load_slept = 0;
+
+const char *load_names[PROF_VECTORS] = {
+    "transmit_data", "sched_tick", "record_av", "rtc_tick", "dead_time"};
+const char *load_tags[PROF_VECTORS + 1] = {"tx", "tk", "av", "rc", "dt", "--"};
+
+void load_loop(uint8_t pending)
+{
+    ++load_loops;
+    if(pending > load_backlog)
+    {
+        load_backlog = pending;
+    }
+}
+
+void load_window()
+{
+    unsigned short int_state = __get_interrupt_state();
+    __disable_interrupt();
+
+    // both in ACLK counts off the one timebase; busy is whatever wasn't asleep
+    uint32_t now = sched_clock();
+    uint32_t span = now - load_window_start;
+    uint32_t idle = (load_slept > span) ? span : load_slept;
+    load_window_start = now;
+    load_slept = 0;
+    load.cpu_pct = span ? (uint8_t)(((span - idle) * 100UL + span / 2) / span) : 0;
+
+    uint16_t loops = load_loops - load_loops_last;
+    load_loops_last += loops;
+    load.loops = (loops > 0xFF) ? 0xFF : loops;
+
+    load.backlog = load_backlog;
+    load_backlog = 0;
+
+    load.busiest = PROF_VECTORS;
+    load.busiest_us = 0;
+    prof_window(&load.busiest, &load.busiest_us);
+
+    __set_interrupt_state(int_state);
+}
+
+void load_dump()
+{
+    uart_puts("\r\ncpu ");
+    uart_put_u16(load.cpu_pct, 0);
+    uart_puts("% busiest ");
+    uart_puts((load.busiest < PROF_VECTORS) ? load_names[load.busiest] : "-");
+    uart_putc(' ');
+    uart_put_u16(load.busiest_us, 0);
+    uart_puts(" us backlog ");
+    uart_put_u16(load.backlog, 0);
+    uart_puts(" loops ");
+    uart_put_u16(load.loops, 0);
+    uart_puts("\r\n");
+}
@@ -9,22 +9,123 @@
 
 #include "src/keypad.h"
 #include "src/lcd.h"
+#include "src/load.h"
+#include "src/profile.h"
+#include "src/sched.h"
+#include "src/telemetry.h"
+#include "src/trace.h"
+#include "src/uart.h"
+#include "common/clock.h"
+#include "common/isr_share.h"
 #include "intrinsics.h"
 #include "msp430fr2355.h"
 
 
-uint8_t current_pattern = 0, avg_temp_flag = 0, cur_sec_elapsed, cur_min_elapsed, ambient_mode = 0, read_temp_flag = 0, read_time_flag = 0, read_sec = 0, has_readt = 0;
+uint8_t current_pattern = 0, ambient_mode = 0, has_readt = 0;
 const uint8_t LED_BAR_ADDR = 0x0A, LM92_ADDR = 0b01001000, RTC_ADDR = 0x68;
+
+// LED bar register map, see i2c-led-bar/app/main.c; status (0x04) and levels (0x10) stay with the bar
+#define BAR_MODE        0x00
+#define BAR_APPLIED     0x01
+#define BAR_PERIOD      0x02
+#define BAR_DROPPED     0x03
+#define BAR_VERSION     0x05
+#define BAR_ANIM        0x06            // animation to upload, then count and frames
+#define BAR_FRAME_COUNT 0x07
+#define BAR_FRAME       0x08
+#define BAR_MAX_FRAMES  8
+#define BAR_CUSTOM      3               // the mode meant for uploaded animations
+uint8_t bar_mode_burst[2] = {BAR_MODE, 0};
+uint8_t bar_period_burst[2] = {BAR_PERIOD, 64};
+#define ANIM_BYTE(reg)  (1 + (reg) - BAR_ANIM)  // where a register lands in the upload, after the pointer
+uint8_t bar_anim_burst[ANIM_BYTE(BAR_FRAME + BAR_MAX_FRAMES)] = {BAR_ANIM};
+
+// one lit LED running up the bar, uploaded from the console
+const uint8_t bar_chase[BAR_MAX_FRAMES] = {BIT0, BIT1, BIT2, BIT3, BIT4, BIT5, BIT6, BIT7};
+
+// LED bar frame period (1/64 s) by whole degrees from target: far away animates fast
+const uint8_t bar_rate_period[8] = {64, 32, 21, 16, 13, 11, 9, 8};
+uint8_t bar_rate_bin = 0;
+
+// LED bar status block (0x00-0x05), polled with every temperature read
+#define BAR_STATUS_SIZE (BAR_VERSION + 1)
+const uint8_t bar_status_ptr[] = {BAR_MODE};
+uint8_t bar_status[BAR_STATUS_SIZE];
+uint8_t bar_rx_idx = 0;
+uint8_t bar_sent = 0;                   // register writes sent, the bar counts them in BAR_APPLIED
+uint8_t bar_backlog = 0;                // of those, not yet applied as far as we know
+const uint8_t *bar_tx = bar_mode_burst; // bytes sent to the LED bar, one per TX IFG
+uint8_t bar_tx_idx = 0;
 char cur_char, cur_state; 
-float lm92_temp_float = 0, lm19_temp= 0;
+float lm19_temp= 0;
 
 // initialize temperature variables
 unsigned int temp_buffer[9];        // maximum window is 9
 unsigned int total = 0;             // walking total of buffer values
-uint16_t lm92_temp = 0;
 uint8_t current_idx = 0;            // index of newest recorded values
 uint8_t window_size = 3;            // default window size
-uint8_t adc_flag =0;                 
+uint16_t lm19_raw = 0;              // as read, for telemetry
+uint8_t i2c_nacks = 0, bar_resyncs = 0;
+uint8_t diag_shown = 0, diag_key_held = 0;
+uint8_t average_task, elapsed_task, bar_check_task;     // event tasks the ISRs post
+
+// Peltier H-bridge legs on P6 and the dead time between them
+#define PELTIER_HEAT    BIT0            // P6.0
+#define PELTIER_COOL    BIT1            // P6.1
+#define DEAD_TIME_MS    100             // a Timer B0 one-shot, see sched_oneshot()
+#define SENSE_MS        500             // sensor tick; Timer B1 triggers the LM19 conversion
+#ifndef I2C_SCL_HZ
+#define I2C_SCL_HZ      400000UL        // fast mode: LM92, RTC and both slaves all take it
+#endif
+#if I2C_SCL_HZ > 400000UL
+#error "I2C_SCL_HZ above fast mode (400 kHz)"
+#endif
+volatile uint8_t pending_leg = 0;       // leg waiting for the dead time to expire
+void dead_time_done();
+
+// LM92 plate temperature, published whole by the I2C ISR once both bytes are in
+typedef struct {
+    uint16_t raw;                       // as read, for telemetry
+    float celsius;
+} Lm92Reading;
+Lm92Reading lm92_latest = {0, 0};
+Snapshot lm92_snap = SNAPSHOT_INIT(lm92_latest);
+uint16_t lm92_msb = 0;                  // first byte, until the second arrives
+uint8_t lm92_rx_idx = 0;
+
+/**
+* @return: the latest LM92 temperature in C
+*/
+float plant_temp()
+{
+    Lm92Reading r;
+    snap_read(&lm92_snap, &r);
+    return r.celsius;
+}
+
+// DS3231: 1 Hz square wave on INT/SQW (P2.1) counts the session, I2C only resyncs it
+#define RTC_SQW         BIT1
+#define SESSION_SEC     300             // 5 min, then off
+#define RESYNC_SEC      60              // full I2C read of the clock this often
+volatile uint16_t elapsed_sec = 0;
+volatile uint8_t resync_count = RESYNC_SEC;
+volatile uint8_t rtc_resync = 0, session_timeout = 0;
+
+// register pointer, then 0x00-0x0F: time and date, alarm 1, alarm 2, control, status
+const uint8_t rtc_session_start[] = {
+    0x00,
+    0x00, 0x00, 0x00, 0x01, 0x01, 0x01, 0x00,   // 00:00:00, day 1, 01/01/00
+    0x80, 0x80, 0x80, 0x80,                     // A1: unused
+    0x80, 0x80, 0x80,                           // A2: unused
+    0x00,                                       // INTCN = 0, RS = 1 Hz: square wave on INT/SQW
+    0x00                                        // clear flags
+};
+const uint8_t rtc_time_ptr[] = {0x00};
+const uint8_t *rtc_tx = rtc_time_ptr;   // bytes sent to the RTC, one per TX IFG
+uint8_t rtc_tx_idx = 0;
+uint8_t rtc_rx[3];                      // seconds, minutes, hours (BCD)
+uint8_t rtc_rx_idx = 0;
+const uint8_t bcd_tens[8] = {0, 10, 20, 30, 40, 50, 60, 70};
 
 // global keypad and pk_attempt initialization
 Keypad keypad = {
@@ -35,29 +136,153 @@ Keypad keypad = {
 };
 
 /**
-* inits pattern transmit
+* waits until the last transfer is off the bus
+*
+* UCTXSTP only covers a STOP already asked for; an autostop burst still
+* counting down to TBCNT has to be waited out before TBCNT or I2CSA change.
 */
-void transmit_pattern()
+void i2c_wait_idle()
 {
-    UCB0TBCNT = 1;
-    UCB0I2CSA = LED_BAR_ADDR;                            
-    while (UCB0CTLW0 & UCTXSTP);                      // Ensure stop condition got sent
+    while (UCB0STATW & UCBBUSY);
+}
+
+/**
+* writes LED bar registers in one burst
+*
+* @param burst: starting register, then the bytes for it and those after it
+* @param len: bytes in burst, pointer included
+*/
+void transmit_bar(const uint8_t *burst, uint8_t len)
+{
+    i2c_wait_idle();
+    UCB0TBCNT = len;
+    UCB0I2CSA = LED_BAR_ADDR;
+    bar_tx = burst;
+    bar_tx_idx = 0;
+    if(len > 1)                                       // pointer-only writes aren't applied
+    {
+        bar_sent++;
+        bar_backlog++;
+    }
+    TRACE(TR_I2C_START, UCB0I2CSA);
     UCB0CTLW0 |= UCTR | UCTXSTT;                      // I2C TX, start condition
 }
 
 /**
-* resets the time
+* inits pattern transmit, if the bar isn't showing it already
+*/
+void transmit_pattern()
+{
+    if(current_pattern == bar_mode_burst[1])
+    {
+        return;
+    }
+    i2c_wait_idle();                              // previous burst may still be sending
+    bar_mode_burst[1] = current_pattern;
+    TRACE(TR_MODE, current_pattern);
+    transmit_bar(bar_mode_burst, sizeof(bar_mode_burst));
+}
+
+/**
+* replaces one of the LED bar's animations; the bar keeps it in FRAM
+*
+* @param anim: animation to replace, one per mode
+* @param frames: LED patterns, bit 0 = first LED
+* @param count: frames, 1-8
+*/
+void bar_upload_anim(uint8_t anim, const uint8_t *frames, uint8_t count)
+{
+    uint8_t i;
+    i2c_wait_idle();                              // previous upload may still be sending
+    bar_anim_burst[ANIM_BYTE(BAR_ANIM)] = anim;
+    bar_anim_burst[ANIM_BYTE(BAR_FRAME_COUNT)] = count;
+    for(i = 0; i < BAR_MAX_FRAMES; i++)
+    {
+        bar_anim_burst[ANIM_BYTE(BAR_FRAME) + i] = (i < count) ? frames[i] : 0;
+    }
+    transmit_bar(bar_anim_burst, sizeof(bar_anim_burst));
+}
+
+/**
+* sends the LED bar a frame period proportional to the temperature error
+*
+* Only match mode has a target (ambient); otherwise the bar runs at 1 s.
+* The slave reloads its timer at the next frame, so the rate can change any time.
+*/
+void transmit_bar_rate()
+{
+    uint8_t bin = 0;
+    if(ambient_mode)
+    {
+        float error = plant_temp() - lm19_temp;
+        if(error < 0)
+        {
+            error = -error;
+        }
+        bin = (error >= 7) ? 7 : (uint8_t)error;
+
+        // 0.25 C of hysteresis so sensor noise on a bin edge doesn't flood the bus
+        if(((bin == bar_rate_bin + 1) && (error < bin + 0.25)) ||
+           ((bin + 1 == bar_rate_bin) && (error > bar_rate_bin - 0.25)))
+        {
+            bin = bar_rate_bin;
+        }
+    }
+    bar_rate_bin = bin;
+
+    uint8_t period = bar_rate_period[bin];
+    if((period != bar_period_burst[1]) && (bar_backlog == 0))    // wait until the last write landed
+    {
+        i2c_wait_idle();                              // previous burst may still be sending
+        bar_period_burst[1] = period;
+        transmit_bar(bar_period_burst, sizeof(bar_period_burst));
+    }
+}
+
+/**
+* checks the LED bar's status block against what it has been sent
+*
+* The bar applies a write as soon as its STOP arrives, so by the time it is polled
+* every write should be counted. Anything unapplied, or a mode or period that doesn't
+* match, means it rebooted or lost a write: both are sent again and counting restarts.
+*/
+void check_bar_status()
+{
+    bar_backlog = bar_sent - bar_status[BAR_APPLIED];
+    if((bar_backlog != 0) || (bar_status[BAR_MODE] != current_pattern) ||
+       (bar_status[BAR_PERIOD] != bar_period_burst[1]))
+    {
+        bar_sent = bar_status[BAR_APPLIED];
+        bar_backlog = 0;
+        ++bar_resyncs;
+        i2c_wait_idle();                              // previous burst may still be sending
+        bar_mode_burst[1] = current_pattern;
+        transmit_bar(bar_mode_burst, sizeof(bar_mode_burst));
+        DELAY_MS(1);
+        i2c_wait_idle();
+        transmit_bar(bar_period_burst, sizeof(bar_period_burst));
+    }
+}
+
+/**
+* resets the time and restarts the 1 Hz square wave in one burst
 */
 void reset_time()
 {
-    UCB0TBCNT = 3;                    // send 3 0s (reg addr, sec, minutes)
-    UCB0I2CSA = RTC_ADDR;                            
-    while (UCB0CTLW0 & UCTXSTP);        // Ensure stop condition got sent
+    i2c_wait_idle();                    // a bar or LCD burst may still be on the bus
+    UCB0TBCNT = sizeof(rtc_session_start);
+    UCB0I2CSA = RTC_ADDR;
+    rtc_tx = rtc_session_start;
+    rtc_tx_idx = 0;
+    TRACE(TR_I2C_START, UCB0I2CSA);
     UCB0CTLW0 |= UCTR | UCTXSTT;        // I2C TX, start condition
-    int reset[] = {0,0,0};
-    lcd_set_time(reset);
-    cur_min_elapsed = 0;
-    cur_sec_elapsed = 0;
+
+    P2IE &= ~RTC_SQW;                   // counter is shared with the SQW ISR
+    elapsed_sec = 0;
+    resync_count = RESYNC_SEC;
+    session_timeout = 0;
+    P2IE |= RTC_SQW;
+    lcd_set_time(0);
 }
 
 /**
@@ -65,27 +290,21 @@ void reset_time()
 */
 void transmit_lcd_mode(uint8_t mode)
 {
+    TRACE(TR_LCD_MODE, mode);
     send_lcd_mode(mode);
     reset_time();               // since we're switching mode, reset rtc time
 }
 
 /**
-* sets the lcd time to the received time from the RTC
+* sets the lcd time to the seconds counted from the RTC square wave
 */
 void transmit_lcd_elapsed_time()
 {
-    uint8_t time_arr[3];
-    // multiply minutes by 60 and add to seconds to get 3 digits
-    int total_sec = cur_min_elapsed * 60;
-    uint8_t ones_digit = cur_sec_elapsed %16;
-    cur_sec_elapsed = (10* (cur_sec_elapsed/16)) + ones_digit;
-    total_sec = total_sec + cur_sec_elapsed;
-
-    time_arr[0] = total_sec / 100; // 100 s
-    time_arr[1] = (total_sec / 10) % 10;
-    time_arr[2] = total_sec % 10;
-
-    lcd_set_time(time_arr);
+    P2IE &= ~RTC_SQW;
+    uint16_t seconds = elapsed_sec;
+    P2IE |= RTC_SQW;
+
+    lcd_set_time(seconds);
 }
 
 /**
@@ -125,6 +344,32 @@ void avg_temp(){
     
 }
 
+/**
+* queues a telemetry record of the current sensor and control state
+*/
+void send_telemetry()
+{
+    Telemetry t;
+    Lm92Reading lm92;
+    snap_read(&lm92_snap, &lm92);
+
+    __disable_interrupt();              // the ISRs write these a piece at a time
+    t.elapsed_sec = elapsed_sec;
+    t.lm19_raw = lm19_raw;
+    t.lm19_avg = total / window_size;
+    t.legs = (P6OUT & (PELTIER_HEAT | PELTIER_COOL)) | (pending_leg << 2);
+    __enable_interrupt();
+
+    t.lm19_centi = (int16_t)(lm19_temp * 100);
+    t.lm92_raw = lm92.raw;
+    t.lm92_centi = (int16_t)(lm92.celsius * 100);
+    t.mode = current_pattern | (ambient_mode << 2);
+    t.i2c_nacks = i2c_nacks;
+    t.bar_resyncs = bar_resyncs;
+    t.bar_dropped = bar_status[BAR_DROPPED];
+    telemetry_send(&t);
+}
+
 /**
 * initializes LED 1, Timers, and LED bar ports
 * 
@@ -137,6 +382,7 @@ void init(void)
 
     // Disable watchdog timer
     WDTCTL = WDTPW | WDTHOLD;
+    init_clock();
 
 //------------- Setup Ports --------------------
     // LED1
@@ -151,31 +397,18 @@ void init(void)
     P6OUT &= ~(BIT1 + BIT0);    // Start off... IMPORTANT!!!!!!!!!!!
 
 
-    // Timer B0
-    // Math: 1s = (1*10^-6)(D1)(D2)(25k)    D1 = 5, D2 = 8
-    TB0CTL |= TBCLR;            // Clear timer and dividers
-    TB0CTL |= TBSSEL__SMCLK;    // Source = SMCLK
-    TB0CTL |= MC__UP;           // Mode UP
-    TB0CTL |= ID__8;            // divide by 8 
-    TB0EX0 |= TBIDEX__5;        // divide by 5 (100)
-
-    TB0CCR0 = 25000;
+    // Timer B0 is the timebase on ACLK: scheduler tick and Peltier dead time,
+    // started by sched_start(). Timer B2 is free, for Peltier PWM.
 
-    TB0CCTL0 &= ~CCIFG;         // Clear CCR0
-    TB0CCTL0 |= CCIE;           // Enable IRQ
-
-    // Timer B1
-    // Math: .5s = (1*10^-6)(D1)(D2)(25k)    D1 = 5, D2 = 4
+    // Timer B1: LM19 sample clock, TB1.1 rising every SENSE_MS starts a conversion
+    // Math: .5s = (1/32768)(ACLK_MS(500)), 16384 ticks
     TB1CTL |= TBCLR;            // Clear timer and dividers
-    TB1CTL |= TBSSEL__SMCLK;    // Source = SMCLK
+    TB1CTL |= TBSSEL__ACLK;     // Source = ACLK
     TB1CTL |= MC__UP;           // Mode UP
-    TB1CTL |= ID__4;            // divide by 4 
-    TB1EX0 |= TBIDEX__5;        // divide by 5 (100)
-
-    TB1CCR0 = 25000;
 
-    TB1CCTL0 &= ~CCIFG;         // Clear CCR0
-    TB1CCTL0 |= CCIE;           // Enable IRQ
+    TB1CCR0 = ACLK_MS(SENSE_MS) - 1;
+    TB1CCR1 = ACLK_MS(SENSE_MS) / 2;
+    TB1CCTL1 = OUTMOD_7;        // reset at CCR1, set at CCR0: no interrupt, just the edge
 
      // Configure Pins for I2C
     P1SEL1 &= ~BIT3;            // P1.3 = SCL
@@ -187,7 +420,7 @@ void init(void)
     UCB0CTLW0 |= UCMODE_3 | UCMST;                    // I2C master mode, SMCLK
     UCB0CTLW1 |= UCASTP_2;                            // Automatic stop after hit TBCNT
     UCB0I2CSA = LED_BAR_ADDR;                         // configure slave address
-    UCB0BRW = 0x8;                                    // baudrate = SMCLK / 8
+    UCB0BRW = I2C_BRW(I2C_SCL_HZ);                    // baudrate = SMCLK / BRW
     UCB0TBCNT = 2;                                    // num bytes to recieve
 
     UCB0CTLW0 &=~ UCSWRST;                            // clear reset register
@@ -199,7 +432,10 @@ void init(void)
     ADCCTL0 |= ADCON;           // Turn ADC ON
 
     ADCCTL1 |= ADCSSEL_2;       // ADC Clock Source = SMCLK
+    ADCCTL1 |= CLOCK_ADCDIV;    // divided to 5 MHz or less
     ADCCTL1 |= ADCSHP;          // Sample signal source = sampling timer
+    ADCCTL1 |= ADCSHS_1;        // Trigger = TB1.1
+    ADCCTL1 |= ADCCONSEQ_2;     // Repeat single channel, once per trigger
 
     ADCCTL2 &= ~ADCRES;         // Clear ADCRES from def. of ADCRES=01
     ADCCTL2 |= ADCRES_2;        // Resolution = 12-bit (ADCRES = 10)
@@ -207,13 +443,51 @@ void init(void)
     ADCMCTL0 |= ADCINCH_1;      // ADC Input Channel = A2 (P1.1): sends A2 to ADC
 
     ADCIE |= ADCIE0;            // Enable ADC Conv Complete IRQ
+    ADCCTL0 |= ADCENC;          // Armed; Timer B1 starts each conversion
+
+    // RTC INT/SQW: open drain 1 Hz square wave
+    P2DIR &= ~RTC_SQW;          // Config as Input
+    P2REN |= RTC_SQW;           // Enable pull up/down resistor
+    P2OUT |= RTC_SQW;           // Set pull up resistor
+    P2IES |= RTC_SQW;           // Falling edge
+    P2IE |= RTC_SQW;            // Enable IRQ
 
 //------------- END PORT SETUP -------------------
 
     PM5CTL0 &= ~LOCKLPM5;   // turn on GPIO
+    P2IFG &= ~RTC_SQW;      // unlocking can latch a false edge
     __enable_interrupt();   // enable maskable IRQs
 }
 
+/**
+* drives one Peltier leg (or none), returning immediately
+*
+* Switching legs drops the bridge and times the dead time with sched_oneshot()
+* on TB0 CCR2; the new leg is raised from that ISR once it has passed.
+* Safe to call from an ISR.
+*
+* @param leg: PELTIER_HEAT, PELTIER_COOL, or 0 for off
+*/
+void drive_peltier(uint8_t leg)
+{
+    unsigned short int_state = __get_interrupt_state();
+    __disable_interrupt();
+
+    uint8_t active = P6OUT & (PELTIER_HEAT | PELTIER_COOL);
+    if((leg == 0) || ((active != leg) && (pending_leg != leg)))
+    {
+        P6OUT &= ~(PELTIER_HEAT | PELTIER_COOL);    // never both legs at once
+        sched_oneshot_cancel();                     // stop any dead time in progress
+        pending_leg = leg;
+        if(leg != 0)
+        {
+            sched_oneshot(DEAD_TIME_MS, dead_time_done);
+        }
+    }
+
+    __set_interrupt_state(int_state);
+}
+
 /**
 * sets state, turning on or off heating and cooling modes
 */
@@ -223,17 +497,11 @@ void set_state(char state)
     switch(cur_state)   
     {
         case HEAT:                      // set heat pin to 1, cool pin to 0
-            P6OUT &= ~BIT1;
-            __delay_cycles(100000);
-            P6OUT |= BIT0;
-            
+            drive_peltier(PELTIER_HEAT);
             current_pattern = 2;
             break;
         case COOL:                      // set heat pin to 0, cool pin to 1
-            P6OUT &= ~BIT0;
-            __delay_cycles(100000);
-            P6OUT |= BIT1;
-           
+            drive_peltier(PELTIER_COOL);
             current_pattern = 1;
             break;
         case OFF:                       // set pins to be both 0 V
@@ -242,7 +510,7 @@ void set_state(char state)
                 ambient_mode = 0;
             }
             current_pattern = 0;
-            P6OUT &= ~(BIT1 + BIT0);
+            drive_peltier(0);
             break;
         default:
             
@@ -253,126 +521,255 @@ void set_state(char state)
 
 
 /**
-* Handle character reading and flags
+* sensor tick: LM92 read and, once a minute, the RTC; Timer B1 converts the LM19
 */
-int main(void)
+void task_sense()
 {
-    cur_char = 'Z';
-    int ret = FAILURE;
+    P6OUT ^= BIT6;                          // LED2: sensors sampled
 
-    init();
-    init_lcd();
-    init_keypad(&keypad);
-    set_state(OFF);
-    DELAY_0001;
-    transmit_lcd_mode(3);                    // resets time too
+    if(telemetry_due())
+    {
+        send_telemetry();                   // last tick's readings
+    }
+
+    // read temperature from LM92
+    DELAY_MS(1);
+    i2c_wait_idle();
+    UCB0TBCNT = 2;
+    UCB0I2CSA = LM92_ADDR;
 
-    while(1)
+    UCB0CTLW0 &= ~UCTR;          // Put into Rx mode
+    TRACE(TR_I2C_START, UCB0I2CSA);
+    UCB0CTLW0 |= UCTXSTT;        // generate START cond.
+
+    // send register address of time, read seconds, minutes, hours
+    if(rtc_resync)
     {
-        ret = scan_keypad(&keypad, &cur_char);
-        __delay_cycles(100000);             // Delay for 100000*(1/MCLK)=0.1s
-        if (ret == SUCCESS)
-        {
-            switch(cur_char)
-            {
-                case HEAT:
-                    if((cur_state != HEAT) || (ambient_mode == 1))
-                    {
-                        ambient_mode = 0;
-                        set_state(HEAT);
-                        transmit_lcd_mode(0);
-                    }
-                    break;
-                case COOL:
-                    if((cur_state != COOL) || (ambient_mode == 1))
-                    {
-                        ambient_mode = 0;
-                        set_state(COOL);
-                        transmit_lcd_mode(1);
-                    }
-                    break;
-                case AMBIENT:
-                    if(ambient_mode == 0)
-                    {
-                        ambient_mode = 1;
-                        transmit_lcd_mode(2);
-                    }
-                    break;
-                case OFF:
-                    if(cur_state!= OFF)
-                    {
-                        set_state(OFF);
-                        transmit_lcd_mode(3);
-                    }
-                    break;
-                default:
-                    break;
-            }
-        }
+        rtc_resync = 0;
+        DELAY_MS(1);
+        i2c_wait_idle();
+        UCB0TBCNT = 1;
+        UCB0I2CSA = RTC_ADDR;
+        rtc_tx = rtc_time_ptr;
+        rtc_tx_idx = 0;
+        TRACE(TR_I2C_START, UCB0I2CSA);
+        UCB0CTLW0 |= UCTR | UCTXSTT;                      // I2C TX, start condition
+        DELAY_MS(1);
+        i2c_wait_idle();
+        UCB0TBCNT = sizeof(rtc_rx);
+        rtc_rx_idx = 0;
+
+        UCB0CTLW0 &= ~UCTR;          // Put into Rx mode
+        TRACE(TR_I2C_START, UCB0I2CSA);
+        UCB0CTLW0 |= UCTXSTT;        // generate START cond.   
+    }
+}
 
-        if(ambient_mode)
+/**
+* LED bar status block: did our writes land, has it rebooted
+*
+* Half a sensor tick after the LM92 read, so the two don't queue on the bus.
+*/
+void task_bar_poll()
+{
+    transmit_bar(bar_status_ptr, sizeof(bar_status_ptr));
+    DELAY_MS(1);
+    i2c_wait_idle();
+    UCB0TBCNT = BAR_STATUS_SIZE;
+    bar_rx_idx = 0;
+
+    UCB0CTLW0 &= ~UCTR;          // Put into Rx mode
+    TRACE(TR_I2C_START, UCB0I2CSA);
+    UCB0CTLW0 |= UCTXSTT;        // generate START cond.
+}
+
+/**
+* the status block arrived
+*/
+void task_bar_check()
+{
+    check_bar_status();
+}
+
+/**
+* ambient match, LED bar rate and the session timeout
+*/
+void task_control()
+{
+    if(ambient_mode)
+    {
+        float plant = plant_temp();
+        // if cooler than ambient, set to heating mode.
+        // tolerance of +/- 2 celsius
+        if(plant < lm19_temp - 1)
         {
-            // if cooler than ambient, set to heating mode.
-            // tolerance of +/- 2 celsius
-            if(lm92_temp_float < lm19_temp - 1)
-            {
-                set_state(HEAT);
-            }
-            // if warmer than ambient, set to cooling mode.
-            else if (lm92_temp_float > lm19_temp + 1)
-            {
-                set_state(COOL);
-            }
-            else 
-            {
-                P6OUT &= ~(BIT1 + BIT0);
-                current_pattern = 0;
-                transmit_pattern();
-            }            
+            set_state(HEAT);
         }
-
-        if(avg_temp_flag)
+        // if warmer than ambient, set to cooling mode.
+        else if (plant > lm19_temp + 1)
         {
-            avg_temp();
-            avg_temp_flag = 0;
+            set_state(COOL);
         }
+        else 
+        {
+            drive_peltier(0);
+            current_pattern = 0;
+            transmit_pattern();
+        }            
+    }
 
-        if(adc_flag)
-        { 
-            ADCCTL0 |= ADCENC | ADCSC;
-            adc_flag = 0;
-        }
+    transmit_bar_rate();
+
+    if(session_timeout)
+    {
+        set_state(OFF);
+        transmit_lcd_mode(3);           // resets time
+    }
+}
 
-        // read temperature from LM92
-        if(read_temp_flag)
+/**
+* mode keys, and # for the load meter
+*/
+void task_keypad()
+{
+    int ret = scan_keypad(&keypad, &cur_char);
+    if (ret == SUCCESS)
+    {
+        switch(cur_char)
         {
-            __delay_cycles(1000);
-            while (UCB0CTLW0 & UCTXSTP);                      // Ensure stop condition got sent
-            UCB0TBCNT = 2;
-            UCB0I2CSA = LM92_ADDR;
+            case HEAT:
+                if((cur_state != HEAT) || (ambient_mode == 1))
+                {
+                    ambient_mode = 0;
+                    set_state(HEAT);
+                    transmit_lcd_mode(0);
+                }
+                break;
+            case COOL:
+                if((cur_state != COOL) || (ambient_mode == 1))
+                {
+                    ambient_mode = 0;
+                    set_state(COOL);
+                    transmit_lcd_mode(1);
+                }
+                break;
+            case AMBIENT:
+                if(ambient_mode == 0)
+                {
+                    ambient_mode = 1;
+                    transmit_lcd_mode(2);
+                }
+                break;
+            case OFF:
+                if(cur_state!= OFF)
+                {
+                    set_state(OFF);
+                    transmit_lcd_mode(3);
+                }
+                break;
+            case '#':                       // load meter on the top row, toggled per press
+                if(!diag_key_held)
+                {
+                    diag_shown = !diag_shown;
+                    lcd_show_diag(diag_shown);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    diag_key_held = (ret == SUCCESS) && (cur_char == '#');
+}
 
-            UCB0CTLW0 &= ~UCTR;          // Put into Rx mode
-            UCB0CTLW0 |= UCTXSTT;        // generate START cond.
+/**
+* LED1 heartbeat, and the load meter's 1 s window
+*/
+void task_heartbeat()
+{
+    P1OUT ^= BIT0;          // LED1 xOR
+    load_window();
+    lcd_set_diag(load.cpu_pct, load_tags[load.busiest], load.busiest_us / 1000, load.backlog);
+}
 
-            // send register address of time, read 
-            if(read_time_flag == 2)
-            {
-                 __delay_cycles(1000);
-                while (UCB0CTLW0 & UCTXSTP);                      // Ensure stop condition got sent
-                UCB0TBCNT = 1;
-                UCB0I2CSA = RTC_ADDR;
-                UCB0CTLW0 |= UCTR | UCTXSTT;                      // I2C TX, start condition
-                __delay_cycles(1000);
-                while (UCB0CTLW0 & UCTXSTP);                      // Ensure stop condition got sent
-                UCB0TBCNT = 2;
-
-                UCB0CTLW0 &= ~UCTR;          // Put into Rx mode
-                UCB0CTLW0 |= UCTXSTT;        // generate START cond.   
-            }
-            
+/**
+* the ambient window filled up
+*/
+void task_average()
+{
+    avg_temp();
+}
+
+/**
+* debug UART commands: p = print ISR profile, r = reset it, t = print the event trace, l = load,
+* s = scheduler, a = upload a chase to the LED bar's custom animation,
+* 0-9 = telemetry every n sensor ticks (0 = off)
+*/
+void task_console()
+{
+    if(uart_cmd)
+    {
+        char cmd = uart_cmd;
+        uart_cmd = 0;
+        if((cmd >= '0') && (cmd <= '9'))
+        {
+            telemetry_period = cmd - '0';
+        }
+        switch(cmd)
+        {
+            case 'p':
+                prof_dump();
+                break;
+            case 'r':
+                prof_reset();
+                break;
+            case 't':
+                trace_dump();
+                break;
+            case 'l':
+                load_dump();
+                break;
+            case 's':
+                sched_dump();
+                break;
+            case 'a':
+                bar_upload_anim(BAR_CUSTOM, bar_chase, sizeof(bar_chase));
+                break;
+            default:
+                break;
         }
-        __delay_cycles(100000);             // Delay for 100000*(1/MCLK)=0.1s
     }
+}
+
+/**
+* Set up the tasks and hand over to the scheduler
+*/
+int main(void)
+{
+    cur_char = 'Z';
+
+    // in trace id order, see host/tools/tracejson.c; staggered so the bus and LCD see one at a time
+    sched_add(task_sense, SENSE_MS, 0, 5);
+    sched_add(task_bar_poll, 500, 250, 3);
+    sched_add(task_control, 100, 50, 4);
+    sched_add(task_keypad, 100, 0, 2);
+    sched_add(task_heartbeat, 1000, 0, 1);
+    sched_add(task_console, 100, 70, 0);
+    average_task = sched_add(task_average, 0, 0, 6);
+    elapsed_task = sched_add(transmit_lcd_elapsed_time, 0, 0, 1);
+    bar_check_task = sched_add(task_bar_check, 0, 0, 4);
+
+    init();
+    init_uart();
+    init_profile();
+    init_trace();
+    init_lcd();
+    init_keypad(&keypad);
+    set_state(OFF);
+    DELAY_0001;
+    transmit_lcd_mode(3);                    // resets time too
+
+    sched_start();
+    sched_run();
 
     return(0);
 }
@@ -386,39 +783,46 @@ int main(void)
 #pragma vector = EUSCI_B0_VECTOR
 __interrupt void transmit_data(void)
 {
+    TRACE(TR_ISR_ENTER, PROF_TRANSMIT_DATA);
+    PROF_ENTER(PROF_TRANSMIT_DATA);
+    LOAD_ENTER();
     switch(UCB0IV)             // determines which IFG has been triggered
     {
     case USCI_I2C_UCNACKIFG:
+        TRACE(TR_I2C_NACK, UCB0I2CSA);
+        ++i2c_nacks;
         UCB0CTL1 |= UCTXSTT;                      //resend start if NACK
         break;                                      // Vector 4: NACKIFG break
     case USCI_I2C_UCTXIFG0:
         if(UCB0I2CSA == LED_BAR_ADDR)
         {
-            UCB0TXBUF = current_pattern;            // Load TX buffer
+            UCB0TXBUF = bar_tx[bar_tx_idx++];       // Load TX buffer
         }
         else if(UCB0I2CSA == RTC_ADDR)
         {
-            // register address begins at 0, then we set sec and min to 0
-            UCB0TXBUF = 0;                          
+            UCB0TXBUF = rtc_tx[rtc_tx_idx++];
         }
         break;
     case USCI_I2C_UCRXIFG0:                 // ID 0x16: Rx IFG
         if(UCB0I2CSA == LM92_ADDR)
         {
-            if(lm92_temp != 0)
+            if(lm92_rx_idx != 0)
             {
-                lm92_temp |= (UCB0RXBUF >> 3);
-                lm92_temp_float = (float)lm92_temp;
-                lm92_temp_float = lm92_temp_float * .0625;
+                Lm92Reading r;
+                uint8_t lsb = UCB0RXBUF;
+                r.raw = lm92_msb | lsb;
+                r.celsius = (float)((lm92_msb >> 3) | (lsb >> 3)) * .0625;
+                snap_write(&lm92_snap, &r);
+                float plant = r.celsius;
 
                 uint8_t int_arr[3];
-                if(lm92_temp_float < 0.1)
+                if(plant < 0.1)
                 {
                     int_arr[0] = 0;
                     int_arr[1] = 0;
                     int_arr[2] = 0;
                 }
-                else if (lm92_temp_float >= 100) 
+                else if (plant >= 100) 
                 {
                     int_arr[0] = 9;
                     int_arr[1] = 9;
@@ -426,81 +830,107 @@ __interrupt void transmit_data(void)
                 }
                 else 
                 {
-                    int_arr[0] = ((int) lm92_temp_float / 10);
-                    int_arr[1] = ((int) lm92_temp_float % 10);
-                    int_arr[2] = ((int)(lm92_temp_float * 10) % 10);
+                    int_arr[0] = ((int) plant / 10);
+                    int_arr[1] = ((int) plant % 10);
+                    int_arr[2] = ((int)(plant * 10) % 10);
                 }
                 set_temperature_plant(int_arr);
 
-                read_temp_flag = 0;
-                lm92_temp = 0;
+                lm92_rx_idx = 0;
             }
             else 
             {
-                lm92_temp = UCB0RXBUF;
-                lm92_temp <<= 5;
+                lm92_msb = (uint16_t)UCB0RXBUF << 8;
+                lm92_rx_idx = 1;
             }
         }
-        else 
+        else if(UCB0I2CSA == LED_BAR_ADDR)
         {
-            if(read_sec)
+            bar_status[bar_rx_idx++] = UCB0RXBUF;
+            if(bar_rx_idx == BAR_STATUS_SIZE)
             {
-                cur_min_elapsed = 0;
-                cur_min_elapsed = UCB0RXBUF; 
-                read_sec = 0;
-                read_time_flag = 0;
-            
-                if(cur_min_elapsed > 4)          // after 300s (5 min), turn off
-                {
-                    __delay_cycles(1000);
-                    set_state(OFF);
-                    transmit_lcd_mode(3);
-   
-                }
-                transmit_lcd_elapsed_time();
+                bar_rx_idx = 0;
+                sched_post(bar_check_task);
+                __bic_SR_register_on_exit(LPM3_bits);   // sched_run() may be asleep
             }
-            else 
+        }
+        else 
+        {
+            rtc_rx[rtc_rx_idx++] = UCB0RXBUF;
+            if(rtc_rx_idx == sizeof(rtc_rx))
             {
-                cur_sec_elapsed = 0;
-                cur_sec_elapsed = UCB0RXBUF;
-                ++read_sec;
+                // correct any drift in the square-wave count
+                uint16_t minutes = bcd_tens[rtc_rx[1] >> 4] + (rtc_rx[1] & 0x0F);
+                uint16_t hours = bcd_tens[(rtc_rx[2] >> 4) & 0x03] + (rtc_rx[2] & 0x0F);
+                elapsed_sec = (hours * 3600) + (minutes * 60) + bcd_tens[rtc_rx[0] >> 4] + (rtc_rx[0] & 0x0F);
+                rtc_rx_idx = 0;
             }
         }
         break;                                    
+    case USCI_I2C_UCBCNTIFG:                // byte count reached, automatic STOP
+        TRACE(TR_I2C_STOP, UCB0I2CSA);
+        break;
     default:
         break;
     }
 
+    LOAD_EXIT();
+    PROF_EXIT(PROF_TRANSMIT_DATA);
+    TRACE(TR_ISR_EXIT, PROF_TRANSMIT_DATA);
 }
 
 
 /**
-* Heartbeat LED, read time every 1s
+* Peltier dead time expired, raise the pending leg; the Timer B0 one-shot
 */
-#pragma vector = TIMER0_B0_VECTOR
-__interrupt void heartbeat_LED(void)
+void dead_time_done()
 {
-    P1OUT ^= BIT0;          // LED1 xOR
-    
-    TB1CCTL0 &= ~CCIFG;     // clear flag
+    TRACE(TR_ISR_ENTER, PROF_DEAD_TIME);
+    PROF_ENTER(PROF_DEAD_TIME);
+    P6OUT |= pending_leg;
+    pending_leg = 0;
+    PROF_EXIT(PROF_DEAD_TIME);
+    TRACE(TR_ISR_EXIT, PROF_DEAD_TIME);
 }
-// ----- end heartbeat_LED-----
+// ----- end dead_time_done-----
 
 /**
-* read from ADC and LM92 every .5s
+* RTC 1 Hz square wave: count the session, cut the Peltier when time is up
 */
-#pragma vector = TIMER1_B0_VECTOR
-__interrupt void read_temps(void)
+#pragma vector = PORT2_VECTOR
+__interrupt void rtc_tick(void)
 {
-    P6OUT ^= BIT6;
-    adc_flag = 1;
-    read_temp_flag = 1;
-    if(cur_state != OFF)
+    TRACE(TR_ISR_ENTER, PROF_RTC_TICK);
+    PROF_ENTER(PROF_RTC_TICK);
+    LOAD_ENTER();
+    switch(P2IV)
     {
-        read_time_flag++;
+    case P2IV__P2IFG1:
+        if((cur_state != OFF) || ambient_mode)
+        {
+            ++elapsed_sec;
+            sched_post(elapsed_task);
+            __bic_SR_register_on_exit(LPM3_bits);   // sched_run() may be asleep
+            if(--resync_count == 0)
+            {
+                resync_count = RESYNC_SEC;
+                rtc_resync = 1;
+            }
+            if(elapsed_sec >= SESSION_SEC)
+            {
+                drive_peltier(0);
+                session_timeout = 1;
+            }
+        }
+        break;
+    default:
+        break;
     }
-    TB1CCTL1 &= ~CCIFG;     // clear flag
+    LOAD_EXIT();
+    PROF_EXIT(PROF_RTC_TICK);
+    TRACE(TR_ISR_EXIT, PROF_RTC_TICK);
 }
+// ----- end rtc_tick-----
 
 /**
 * Read temperature value from ADC
@@ -508,8 +938,12 @@ __interrupt void read_temps(void)
 #pragma vector = ADC_VECTOR
 __interrupt void record_av(void)
 {
+    TRACE(TR_ISR_ENTER, PROF_RECORD_AV);
+    PROF_ENTER(PROF_RECORD_AV);
+    LOAD_ENTER();
     // save to current index
     temp_buffer[current_idx] = ADCMEM0;
+    lm19_raw = temp_buffer[current_idx];
     ++current_idx;
     if((current_idx == window_size) && (has_readt == 0))
     {
@@ -521,7 +955,8 @@ __interrupt void record_av(void)
         {
             total += temp_buffer[i];
         }
-        avg_temp_flag = 1;
+        sched_post(average_task);
+        __bic_SR_register_on_exit(LPM3_bits);   // sched_run() may be asleep
     }
     else if (has_readt == 1) {
         total = 0;
@@ -530,10 +965,14 @@ __interrupt void record_av(void)
         {
             total += temp_buffer[i];
         }
-        avg_temp_flag = 1;
+        sched_post(average_task);
+        __bic_SR_register_on_exit(LPM3_bits);   // sched_run() may be asleep
 
         if (current_idx == window_size) {
             current_idx = 0;
         }
     }
+    LOAD_EXIT();
+    PROF_EXIT(PROF_RECORD_AV);
+    TRACE(TR_ISR_EXIT, PROF_RECORD_AV);
 }
\ No newline at end of file
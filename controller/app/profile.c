@@ -0,0 +1,127 @@
+/**
+* @file
+* @brief ISR cost profiling functionality
+*
+*/
+#include "src/profile.h"
+
+#ifdef ISR_PROFILE
+
+#include "src/uart.h"
+#include "common/clock.h"
+#include "intrinsics.h"
+#include "msp430fr2355.h"
+
+IsrProfile isr_profile[PROF_VECTORS];
+uint32_t prof_window_ticks[PROF_VECTORS];   // time per vector since the last prof_window()
+
+const char *prof_names[PROF_VECTORS] = {
+    "transmit_data", "sched_tick   ", "record_av    ", "rtc_tick     ", "dead_time    "};
+
+void init_profile()
+{
+    // Timer B3: free running, read at ISR entry and exit
+    // Math: 1 tick = (ID)(IDEX)/F_SMCLK = 1 us, wraps every 65.5 ms
+    TB3CTL |= TBCLR;                // Clear timer and dividers
+    TB3CTL |= TBSSEL__SMCLK;        // Source = SMCLK
+    TB3CTL |= TIMER_US_ID;          // divide down to 1 MHz
+    TB3EX0 = TIMER_US_IDEX;
+    TB3CTL |= MC__CONTINUOUS;       // Mode CONTINUOUS, no IRQ
+
+    prof_reset();
+}
+
+void prof_record(uint8_t vector, uint16_t ticks)
+{
+    IsrProfile *p = &isr_profile[vector];
+
+    uint8_t bucket = 0;
+    while((bucket < PROF_BUCKETS - 1) && (ticks >> (bucket + 1)))
+    {
+        ++bucket;
+    }
+
+    prof_window_ticks[vector] += ticks;
+    if(p->count != 0xFFFF)
+    {
+        ++p->count;
+    }
+    if(p->hist[bucket] != 0xFFFF)
+    {
+        ++p->hist[bucket];
+    }
+    if(ticks < p->min)
+    {
+        p->min = ticks;
+    }
+    if(ticks > p->max)
+    {
+        p->max = ticks;
+    }
+}
+
+void prof_reset()
+{
+    unsigned short int_state = __get_interrupt_state();
+    __disable_interrupt();
+
+    uint8_t v, b;
+    for(v = 0; v < PROF_VECTORS; ++v)
+    {
+        isr_profile[v].count = 0;
+        isr_profile[v].min = 0xFFFF;
+        isr_profile[v].max = 0;
+        for(b = 0; b < PROF_BUCKETS; ++b)
+        {
+            isr_profile[v].hist[b] = 0;
+        }
+    }
+
+    __set_interrupt_state(int_state);
+}
+
+void prof_window(uint8_t *vector, uint16_t *us)
+{
+    uint32_t most = 0;
+    uint8_t v;
+    for(v = 0; v < PROF_VECTORS; ++v)
+    {
+        if(prof_window_ticks[v] > most)
+        {
+            most = prof_window_ticks[v];
+            *vector = v;
+        }
+        prof_window_ticks[v] = 0;
+    }
+    if(most)
+    {
+        *us = (most > 0xFFFF) ? 0xFFFF : most;
+    }
+}
+
+void prof_dump()
+{
+    uart_puts("\r\nisr              count   min   max |    <2    <4    <8   <16   <32   <64  <128 >=128\r\n");
+
+    uint8_t v, b;
+    for(v = 0; v < PROF_VECTORS; ++v)
+    {
+        IsrProfile p;
+        __disable_interrupt();      // a consistent row, not one torn by the ISR it describes
+        p = isr_profile[v];
+        __enable_interrupt();
+
+        uart_puts(prof_names[v]);
+        uart_put_u16(p.count, 8);
+        uart_put_u16(p.count ? p.min : 0, 6);
+        uart_put_u16(p.max, 6);
+        uart_puts(" |");
+        for(b = 0; b < PROF_BUCKETS; ++b)
+        {
+            uart_put_u16(p.hist[b], 6);
+        }
+        uart_puts("\r\n");
+    }
+}
+
+#endif
@@ -0,0 +1,292 @@
+/**
+* @file
+* @brief Cooperative task scheduler functionality
+*
+*/
+#include "src/sched.h"
+#include "src/load.h"
+#include "src/profile.h"
+#include "src/trace.h"
+#include "src/uart.h"
+#include "common/clock.h"
+#include "common/isr_share.h"
+#include "intrinsics.h"
+#include "msp430fr2355.h"
+
+#define SCHED_NONE      0xFF
+
+// ACLK counts per tick: a whole part, and a remainder spread over the ticks
+// so they average out exact; 327 + 68/100 at 100 Hz
+#define TICK_COUNTS     ((uint16_t)(F_ACLK / SCHED_TICK_HZ))
+#define TICK_REM        ((uint16_t)(F_ACLK % SCHED_TICK_HZ))
+
+Task sched_tasks[SCHED_MAX_TASKS];
+uint8_t sched_count = 0;
+uint8_t sched_wheel[SCHED_SLOTS];       // first task per slot
+volatile uint16_t sched_now = 0;        // ticks since sched_start()
+Events sched_ready = 0;                 // bit n: task n ready
+uint16_t sched_frac = 0;                // remainder carried toward the next extra count
+TaskFn sched_oneshot_fn;                // runs when CCR2 matches
+volatile uint16_t sched_wraps = 0;      // TB0R overflows, the high word of sched_clock()
+
+const uint16_t sched_bits[SCHED_MAX_TASKS] = {
+    BIT0, BIT1, BIT2, BIT3, BIT4, BIT5, BIT6, BIT7, BIT8, BIT9, BITA, BITB, BITC, BITD, BITE, BITF};
+
+/**
+* TB0R, read until two reads agree: it counts on ACLK, not MCLK
+*/
+static inline uint16_t timebase_count()
+{
+    uint16_t a, b = TB0R;
+    do
+    {
+        a = b;
+        b = TB0R;
+    } while(a != b);
+    return a;
+}
+
+/**
+* links a periodic task into the slot for its due tick
+*/
+static void sched_insert(uint8_t id)
+{
+    uint8_t slot = sched_tasks[id].due & (SCHED_SLOTS - 1);
+    sched_tasks[id].next = sched_wheel[slot];
+    sched_wheel[slot] = id;
+}
+
+uint8_t sched_add(TaskFn fn, uint16_t period_ms, uint16_t phase_ms, uint8_t priority)
+{
+    Task *t = &sched_tasks[sched_count];
+    t->fn = fn;
+    t->period = period_ms / SCHED_TICK_MS;
+    t->due = (phase_ms >= SCHED_TICK_MS) ? (phase_ms / SCHED_TICK_MS) : 1;  // tick 0 has passed
+    t->priority = priority;
+    t->next = SCHED_NONE;
+    t->overruns = 0;
+    return sched_count++;
+}
+
+void sched_post(uint8_t id)
+{
+    events_post(&sched_ready, sched_bits[id]);
+}
+
+void init_timebase()
+{
+    if((TB0CTL & MC) == MC__STOP)
+    {
+        // Timer B0: the timebase, free running on ACLK (REFO) so it runs in LPM3
+        // Math: 1 count = 1/32768 s, wraps every 2 s
+        TB0CTL |= TBCLR;            // Clear timer and dividers
+        TB0CTL |= TBSSEL__ACLK;     // Source = ACLK
+        TB0CTL |= MC__CONTINUOUS;   // Mode CONTINUOUS
+        TB0CTL &= ~TBIFG;
+        TB0CTL |= TBIE;             // count wraps for sched_clock()
+    }
+}
+
+uint32_t sched_clock()
+{
+    unsigned short int_state = __get_interrupt_state();
+    __disable_interrupt();
+    uint16_t hi = sched_wraps;
+    uint16_t lo = timebase_count();
+    if((TB0CTL & TBIFG) && (lo < 0x8000))
+    {
+        ++hi;                       // wrapped, ISR not run yet
+    }
+    __set_interrupt_state(int_state);
+    return ((uint32_t)hi << 16) | lo;
+}
+
+void sched_start()
+{
+    uint8_t i;
+    for(i = 0; i < SCHED_SLOTS; ++i)
+    {
+        sched_wheel[i] = SCHED_NONE;
+    }
+    for(i = 0; i < sched_count; ++i)
+    {
+        if(sched_tasks[i].period)
+        {
+            sched_insert(i);
+        }
+    }
+    sched_now = 0;
+    sched_ready = 0;
+
+    // CCR1 is the tick, moved on by TICK_COUNTS each time; CCR2 is the one-shot
+    // Math: 10ms = (1/32768)(327.68) on average
+    init_timebase();            // may be running already for the trace
+
+    sched_frac = 0;
+    TB0CCR1 = timebase_count() + TICK_COUNTS;
+
+    TB0CCTL1 &= ~CCIFG;         // Clear CCR1
+    TB0CCTL1 |= CCIE;           // Enable IRQ
+}
+
+void sched_oneshot(uint16_t ms, TaskFn fn)
+{
+    unsigned short int_state = __get_interrupt_state();
+    __disable_interrupt();
+    TB0CCTL2 &= ~(CCIE | CCIFG);
+    sched_oneshot_fn = fn;
+    TB0CCR2 = timebase_count() + ACLK_MS(ms);
+    TB0CCTL2 |= CCIE;
+    __set_interrupt_state(int_state);
+}
+
+void sched_oneshot_cancel()
+{
+    TB0CCTL2 &= ~(CCIE | CCIFG);
+}
+
+void sched_run()
+{
+    while(1)
+    {
+        uint16_t ready = sched_ready;           // one read; bits only get added behind it
+        uint8_t i, pick = SCHED_NONE, pending = 0;
+        for(i = 0; i < sched_count; ++i)
+        {
+            if(ready & sched_bits[i])
+            {
+                ++pending;
+                if((pick == SCHED_NONE) || (sched_tasks[i].priority > sched_tasks[pick].priority))
+                {
+                    pick = i;
+                }
+            }
+        }
+        if(pick == SCHED_NONE)
+        {
+            // LPM3: only ACLK runs, SMCLK comes back for a peripheral that requests it
+            __disable_interrupt();
+            if(!sched_ready)
+            {
+                uint32_t slept = sched_clock();
+                load_asleep = 1;
+                __bis_SR_register(LPM3_bits | GIE);
+                __disable_interrupt();          // an ISR from here on is main's time
+                load_asleep = 0;
+                load_slept += sched_clock() - slept;
+            }
+            __enable_interrupt();
+            continue;
+        }
+        events_take(&sched_ready, sched_bits[pick]);
+        load_loop(pending);
+        TRACE(TR_TASK_BEGIN, pick);
+        sched_tasks[pick].fn();
+        TRACE(TR_TASK_END, pick);
+    }
+}
+
+void sched_dump()
+{
+    uart_puts("\r\nsched tick ");
+    uart_put_u16(sched_now, 0);
+    uart_puts("\r\n");
+    uint8_t i;
+    for(i = 0; i < sched_count; ++i)
+    {
+        uart_put_u16(i, 2);
+        uart_puts(" period ");
+        uart_put_u16(sched_tasks[i].period * SCHED_TICK_MS, 5);
+        uart_puts(" ms overruns ");
+        uart_put_u16(sched_tasks[i].overruns, 3);
+        uart_puts("\r\n");
+    }
+}
+
+/**
+* scheduler tick: mark the tasks in this tick's wheel slot that are due
+*/
+static inline void sched_wheel_tick()
+{
+    TB0CCR1 += TICK_COUNTS;
+    sched_frac += TICK_REM;
+    if(sched_frac >= SCHED_TICK_HZ)
+    {
+        sched_frac -= SCHED_TICK_HZ;
+        ++TB0CCR1;
+    }
+
+    uint16_t now = ++sched_now;
+    uint8_t *link = &sched_wheel[now & (SCHED_SLOTS - 1)];
+    uint8_t fired = SCHED_NONE;
+
+    while(*link != SCHED_NONE)
+    {
+        uint8_t id = *link;
+        Task *t = &sched_tasks[id];
+        if(t->due == now)
+        {
+            *link = t->next;                // unlink, relinked below once the slot is done
+            t->next = fired;
+            fired = id;
+            if(sched_ready & sched_bits[id])
+            {
+                if(t->overruns != 0xFF)
+                {
+                    ++t->overruns;
+                }
+            }
+            events_post(&sched_ready, sched_bits[id]);
+        }
+        else
+        {
+            link = &t->next;
+        }
+    }
+    while(fired != SCHED_NONE)
+    {
+        uint8_t id = fired;
+        fired = sched_tasks[id].next;
+        sched_tasks[id].due += sched_tasks[id].period;
+        sched_insert(id);
+    }
+}
+
+//-- Interrupt Service Routines -----------------------
+
+/**
+* Timer B0 timebase: CCR1 the tick, CCR2 the one-shot, overflow the clock's high word
+*/
+#pragma vector = TIMER0_B1_VECTOR
+__interrupt void sched_tick(void)
+{
+    LOAD_ENTER();
+    switch(__even_in_range(TB0IV, TBIV__TBIFG))
+    {
+    case TBIV__TBCCR1:
+        TRACE(TR_ISR_ENTER, PROF_SCHED_TICK);
+        PROF_ENTER(PROF_SCHED_TICK);
+        do
+        {
+            sched_wheel_tick();         // once more for each tick a long ISR held this one past
+        } while((int16_t)(TB0CCR1 - timebase_count()) <= 0);
+        PROF_EXIT(PROF_SCHED_TICK);
+        TRACE(TR_ISR_EXIT, PROF_SCHED_TICK);
+        break;
+    case TBIV__TBCCR2:
+        TB0CCTL2 &= ~CCIE;          // one-shot: off until sched_oneshot() again
+        sched_oneshot_fn();
+        break;
+    case TBIV__TBIFG:
+        ++sched_wraps;
+        break;
+    default:
+        break;
+    }
+    if(sched_ready)
+    {
+        __bic_SR_register_on_exit(LPM3_bits);
+    }
+    LOAD_EXIT();
+}
+// ----- end sched_tick-----
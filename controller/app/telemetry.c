@@ -0,0 +1,82 @@
+/**
+* @file
+* @brief Binary telemetry stream functionality
+*
+*/
+#include "src/telemetry.h"
+#include "src/uart.h"
+
+uint8_t telemetry_period = TELEMETRY_PERIOD;
+uint8_t telemetry_count = 0;
+uint16_t telemetry_seq = 0;             // counts dropped frames too, so gaps show them
+uint8_t telemetry_dropped = 0;
+
+uint8_t telemetry_due()
+{
+    if((telemetry_period == 0) || (++telemetry_count < telemetry_period))
+    {
+        return 0;
+    }
+    telemetry_count = 0;
+    return 1;
+}
+
+/**
+* CRC-16/CCITT, one byte at a time
+*/
+static uint16_t crc16_update(uint16_t crc, uint8_t byte)
+{
+    uint8_t i;
+    crc ^= (uint16_t)byte << 8;
+    for(i = 0; i < 8; ++i)
+    {
+        crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+    }
+    return crc;
+}
+
+static uint8_t *put16(uint8_t *p, uint16_t value)
+{
+    *p++ = value & 0xFF;
+    *p++ = value >> 8;
+    return p;
+}
+
+void telemetry_send(Telemetry *t)
+{
+    uint8_t frame[TELEMETRY_PAYLOAD + 5];
+    uint8_t *p = frame;
+
+    t->dropped = telemetry_dropped;
+
+    *p++ = TELEMETRY_SYNC0;
+    *p++ = TELEMETRY_SYNC1;
+    *p++ = TELEMETRY_PAYLOAD;
+    *p++ = TELEMETRY_VERSION;
+    p = put16(p, telemetry_seq++);
+    p = put16(p, t->elapsed_sec);
+    p = put16(p, t->lm19_raw);
+    p = put16(p, t->lm19_avg);
+    p = put16(p, t->lm92_raw);
+    p = put16(p, (uint16_t)t->lm19_centi);
+    p = put16(p, (uint16_t)t->lm92_centi);
+    *p++ = t->mode;
+    *p++ = t->legs;
+    *p++ = t->i2c_nacks;
+    *p++ = t->bar_resyncs;
+    *p++ = t->bar_dropped;
+    *p++ = t->dropped;
+
+    uint16_t crc = 0xFFFF;
+    uint8_t *c;
+    for(c = frame + 2; c < p; ++c)
+    {
+        crc = crc16_update(crc, *c);
+    }
+    p = put16(p, crc);
+
+    if(!uart_write(frame, p - frame))
+    {
+        ++telemetry_dropped;
+    }
+}
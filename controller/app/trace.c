@@ -0,0 +1,90 @@
+/**
+* @file
+* @brief FRAM event trace functionality
+*
+*/
+#include "src/trace.h"
+
+#ifdef EVENT_TRACE
+
+#include "src/sched.h"
+#include "src/uart.h"
+#include "intrinsics.h"
+#include "msp430fr2355.h"
+
+// kept across resets; only ever written with the program FRAM briefly unlocked
+#pragma PERSISTENT(trace_buf)
+TraceRecord trace_buf[TRACE_LEN] = {0};
+#pragma PERSISTENT(trace_head)
+uint16_t trace_head = 0;            // next record written
+#pragma PERSISTENT(trace_count)
+uint16_t trace_count = 0;           // records held, up to TRACE_LEN
+
+volatile uint8_t trace_paused = 0;
+
+void init_trace()
+{
+    init_timebase();                // ACLK, so stamping doesn't keep SMCLK up in LPM3
+    trace_log(TR_BOOT, 0);
+}
+
+void trace_log(uint8_t type, uint8_t arg)
+{
+    unsigned short int_state = __get_interrupt_state();
+    __disable_interrupt();
+
+    if(!trace_paused)
+    {
+        uint32_t now = sched_clock();
+
+        SYSCFG0 = FRWPPW | DFWP;            // program FRAM writable
+        TraceRecord *r = &trace_buf[trace_head];
+        r->time_lo = (uint16_t)now;
+        r->time_hi = (uint16_t)(now >> 16);
+        r->type = type;
+        r->arg = arg;
+        if(++trace_head == TRACE_LEN)
+        {
+            trace_head = 0;
+        }
+        if(trace_count < TRACE_LEN)
+        {
+            ++trace_count;
+        }
+        SYSCFG0 = FRWPPW | DFWP | PFWP;     // and protected again
+    }
+
+    __set_interrupt_state(int_state);
+}
+
+void trace_dump()
+{
+    trace_paused = 1;
+
+    uint16_t n = trace_count;
+    uint16_t idx = (trace_head >= n) ? (trace_head - n) : (trace_head + TRACE_LEN - n);
+
+    uart_puts("\r\ntrace ");
+    uart_put_u16(n, 0);
+    uart_puts("\r\n");
+    while(n--)
+    {
+        const TraceRecord *r = &trace_buf[idx];
+        uart_put_hex(r->time_hi, 4);            // raw ACLK counts; tracejson converts to us
+        uart_put_hex(r->time_lo, 4);
+        uart_putc(' ');
+        uart_put_hex(r->type, 2);
+        uart_putc(' ');
+        uart_put_hex(r->arg, 2);
+        uart_puts("\r\n");
+        if(++idx == TRACE_LEN)
+        {
+            idx = 0;
+        }
+    }
+    uart_puts("end\r\n");
+
+    trace_paused = 0;
+}
+
+#endif
@@ -0,0 +1,150 @@
+/**
+* @file
+* @brief Debug UART functionality
+*
+*/
+#include "src/uart.h"
+#include "src/load.h"
+#include "common/clock.h"
+#include "common/isr_share.h"
+#include "intrinsics.h"
+#include "msp430fr2355.h"
+
+volatile char uart_cmd = 0;
+
+// Math: N = F_SMCLK / baud. At N >= 16 oversample: UCBRx = N / 16, UCBRFx = N mod 16;
+// otherwise UCBRx = N. UCBRSx comes from the fraction of N, user's guide table 22-4.
+#define UART_N10K       ((F_SMCLK * 10000ULL) / UART_BAUD)      // N in 1/10000ths
+#define UART_FRAC       ((uint16_t)(UART_N10K % 10000))
+#define UART_OS16       (UART_N10K >= 160000)
+#define UART_BRW        ((uint16_t)(UART_OS16 ? (UART_N10K / 160000) : (UART_N10K / 10000)))
+#define UART_BRF        (UART_OS16 ? (((UART_N10K / 10000) % 16) << 4) : 0)
+#define UART_BRS        ((UART_FRAC >= 9288) ? 0xFE : (UART_FRAC >= 9170) ? 0xFD : (UART_FRAC >= 9004) ? 0xFB : \
+                         (UART_FRAC >= 8751) ? 0xF7 : (UART_FRAC >= 8572) ? 0xEF : (UART_FRAC >= 8464) ? 0xDF : \
+                         (UART_FRAC >= 8333) ? 0xBF : (UART_FRAC >= 8004) ? 0xEE : (UART_FRAC >= 7861) ? 0xED : \
+                         (UART_FRAC >= 7503) ? 0xDD : (UART_FRAC >= 7147) ? 0xBB : (UART_FRAC >= 7001) ? 0xB7 : \
+                         (UART_FRAC >= 6667) ? 0xD6 : (UART_FRAC >= 6432) ? 0xB6 : (UART_FRAC >= 6254) ? 0xB5 : \
+                         (UART_FRAC >= 6003) ? 0xAD : (UART_FRAC >= 5715) ? 0x6B : (UART_FRAC >= 5002) ? 0xAA : \
+                         (UART_FRAC >= 4378) ? 0x55 : (UART_FRAC >= 4286) ? 0x53 : (UART_FRAC >= 4003) ? 0x92 : \
+                         (UART_FRAC >= 3753) ? 0x52 : (UART_FRAC >= 3575) ? 0x4A : (UART_FRAC >= 3335) ? 0x49 : \
+                         (UART_FRAC >= 3000) ? 0x25 : (UART_FRAC >= 2503) ? 0x44 : (UART_FRAC >= 2224) ? 0x22 : \
+                         (UART_FRAC >= 2147) ? 0x21 : (UART_FRAC >= 1670) ? 0x11 : (UART_FRAC >= 1430) ? 0x20 : \
+                         (UART_FRAC >= 1252) ? 0x10 : (UART_FRAC >= 1001) ? 0x08 : (UART_FRAC >= 835) ? 0x04 : \
+                         (UART_FRAC >= 715) ? 0x02 : (UART_FRAC >= 529) ? 0x01 : 0x00)
+
+// main puts, the TX ISR takes
+uint8_t uart_tx_buf[UART_TX_SIZE];
+Ring uart_tx = RING_INIT(uart_tx_buf);
+
+void init_uart()
+{
+    // Configure Pins for UART
+    P4SEL1 &= ~(BIT2 | BIT3);
+    P4SEL0 |= BIT2 | BIT3;              // P4.2 = RXD, P4.3 = TXD
+
+    // e.g. 115200 baud at 1 MHz: N = 8.68, UCBRx = 8, UCBRSx = 0xD6, no oversampling
+    //      at 16 MHz: N = 138.9, UCBRx = 8, UCBRFx = 10, UCBRSx = 0xF7, oversampled
+    UCA1CTLW0 |= UCSWRST;               // put eUSCI_A in reset state
+    UCA1CTLW0 |= UCSSEL__SMCLK;         // Source = SMCLK
+    UCA1BRW = UART_BRW;
+    UCA1MCTLW = (UART_BRS << 8) | UART_BRF | (UART_OS16 ? UCOS16 : 0);
+
+    UCA1CTLW0 &= ~UCSWRST;              // clear reset register
+    UCA1IE |= UCRXIE;                   // receive IRQ for commands
+}
+
+void uart_putc(char c)
+{
+    while(!ring_put(&uart_tx, c))
+    {
+        DELAY_US(87);                   // full: give the ISR a byte time
+    }
+    UCA1IE |= UCTXIE;
+}
+
+uint8_t uart_write(const uint8_t *data, uint8_t len)
+{
+    if(len > ring_room(&uart_tx))
+    {
+        return 0;
+    }
+    while(len--)
+    {
+        ring_put(&uart_tx, *data++);
+    }
+    UCA1IE |= UCTXIE;
+    return 1;
+}
+
+void uart_puts(const char *str)
+{
+    while(*str)
+    {
+        uart_putc(*str++);
+    }
+}
+
+void uart_put_u16(uint16_t value, uint8_t width)
+{
+    char digits[5];
+    uint8_t n = 0;
+    do
+    {
+        digits[n++] = '0' + (value % 10);
+        value /= 10;
+    } while(value);
+
+    while(width > n)
+    {
+        uart_putc(' ');
+        --width;
+    }
+    while(n)
+    {
+        uart_putc(digits[--n]);
+    }
+}
+
+void uart_put_hex(uint16_t value, uint8_t digits)
+{
+    while(digits--)
+    {
+        uint8_t nibble = (value >> (4 * digits)) & 0x0F;
+        uart_putc((nibble < 10) ? ('0' + nibble) : ('a' + nibble - 10));
+    }
+}
+
+//-- Interrupt Service Routines -----------------------
+
+/**
+* latch a command byte for main, send the next queued byte
+*/
+#pragma vector = EUSCI_A1_VECTOR
+__interrupt void uart_data(void)
+{
+    LOAD_ENTER();
+    switch(UCA1IV)
+    {
+    case USCI_UART_UCRXIFG:
+        uart_cmd = UCA1RXBUF;
+        break;
+    case USCI_UART_UCTXIFG:
+    {
+        uint8_t byte;
+        if(ring_get(&uart_tx, &byte))
+        {
+            UCA1TXBUF = byte;
+        }
+        else
+        {
+            UCA1IFG |= UCTXIFG;         // reading the IV cleared it; keep it for the next byte
+            UCA1IE &= ~UCTXIE;          // queue empty, main re-enables
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    LOAD_EXIT();
+}
+// ----- end uart_data-----
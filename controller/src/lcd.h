@@ -4,10 +4,11 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <msp430fr2355.h>
+#include "common/clock.h"
 
 // delays
-#define DELAY_0001  __delay_cycles(1000)         // 0.001 s
-#define DELAY_001   __delay_cycles(10000)        // 0.01 s
+#define DELAY_0001  DELAY_MS(1)             // 0.001 s
+#define DELAY_001   DELAY_MS(10)            // 0.01 s
 
 // LCD Commands
 #define LCD_FUNCTION            0x28    // 4 bit, 2 lines
@@ -61,11 +62,28 @@ void send_lcd_mode(uint8_t mode);
 
 
 /**
-* set elapsed time in seconds
+* swap the top row between mode and ambient temperature and the load meter
 * 
-* @param data: time in seconds (must be converted )
+* @param on: 1 for the load meter
 */
-void lcd_set_time(uint8_t *data);
+void lcd_show_diag(uint8_t on);
+
+/**
+* update the load meter, drawn if it is showing
+* 
+* @param cpu_pct: busy share of the last second
+* @param isr: two-letter name of the busiest ISR
+* @param isr_ms: its total ms in the last second
+* @param backlog: most work flags pending at once in main
+*/
+void lcd_set_diag(uint8_t cpu_pct, const char *isr, uint8_t isr_ms, uint8_t backlog);
+
+/**
+* set elapsed time, shown as mm:ss or h:mm:ss
+* 
+* @param seconds: elapsed time in seconds (clamped at 9:59:59)
+*/
+void lcd_set_time(uint16_t seconds);
 
 /**
 * set temperature to the 3 digits that've been sent over
@@ -0,0 +1,60 @@
+/**
+* @file
+* @brief Header file for the CPU load meter
+*
+* Everything is timed on the Timer B0 ACLK timebase. Main sleeps in LPM3 in
+* sched_run() whenever no task is ready; sched_run() reads sched_clock()
+* either side of the sleep and adds up the counts. ISRs that run meanwhile
+* take their own time back off through LOAD_ENTER/LOAD_EXIT, so only the
+* time the CPU was really stopped is idle. Busy waits are busy.
+*
+* Once a second the heartbeat task closes a window, also by sched_clock():
+* whatever of it wasn't idle was busy, in ISRs or in tasks. The busiest ISR comes from the profiler, so it
+* is only known in builds with ISR_PROFILE.
+*/
+#ifndef LOAD_H
+#define LOAD_H
+
+#include <stdint.h>
+
+#include "src/profile.h"
+#include "src/sched.h"
+
+/**
+* the last closed window
+*/
+typedef struct {
+    uint8_t cpu_pct;                    // busy share of the window
+    uint8_t busiest;                    // PROF_ vector with the most time, PROF_VECTORS if unknown
+    uint16_t busiest_us;                // its total time in the window, saturating
+    uint8_t backlog;                    // most tasks ready at once
+    uint8_t loops;                      // task runs, saturating
+} LoadReport;
+
+extern LoadReport load;
+extern volatile uint8_t load_asleep;   // set by sched_run() around its LPM3 sleep
+extern volatile uint32_t load_slept;    // ACLK counts asleep since the last window, ISRs taken off
+
+// bracket an ISR body, so the time it takes out of main's sleep isn't idle
+#define LOAD_ENTER()    uint32_t load_start = load_asleep ? sched_clock() : 0
+#define LOAD_EXIT()     if(load_asleep) { load_slept -= sched_clock() - load_start; }
+extern const char *load_tags[PROF_VECTORS + 1];    // two-letter ISR names for the LCD, "--" last
+
+/**
+* counts one task run
+*
+* @param pending: tasks ready when it was picked, itself included
+*/
+void load_loop(uint8_t pending);
+
+/**
+* closes the window, once a second
+*/
+void load_window();
+
+/**
+* prints the last window on the debug UART
+*/
+void load_dump();
+
+#endif
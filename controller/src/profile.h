@@ -0,0 +1,91 @@
+/**
+* @file
+* @brief Header file for ISR cost profiling
+*
+* Timer B3 runs free on SMCLK, 1 us a tick. PROF_ENTER/PROF_EXIT bracket an
+* ISR body and bin its duration per vector; prof_dump() prints the table on
+* the debug UART. Builds with NDEBUG defined (CCS Release) compile it all out;
+* the rest keep SMCLK running through the LPM3 sleep for Timer B3.
+*/
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <msp430fr2355.h>
+
+#ifndef NDEBUG
+#define ISR_PROFILE
+#endif
+
+// profiled vectors
+#define PROF_TRANSMIT_DATA  0
+#define PROF_SCHED_TICK     1
+#define PROF_RECORD_AV      2
+#define PROF_RTC_TICK       3
+#define PROF_DEAD_TIME      4
+#define PROF_VECTORS        5
+
+#define PROF_BUCKETS        8       // <2, <4, <8 ... <128, >=128 us
+
+#ifdef ISR_PROFILE
+
+/**
+* duration statistics for one vector, in us
+*/
+typedef struct {
+    uint16_t count;                 // saturates, as do the buckets
+    uint16_t min;
+    uint16_t max;
+    uint16_t hist[PROF_BUCKETS];
+} IsrProfile;
+
+extern IsrProfile isr_profile[PROF_VECTORS];
+
+#define PROF_ENTER(v)   uint16_t prof_start = TB3R
+#define PROF_EXIT(v)    prof_record((v), TB3R - prof_start)
+
+/**
+* starts Timer B3 free running and clears the statistics
+*/
+void init_profile();
+
+/**
+* bins one ISR duration, called from the ISR itself
+*
+* @param vector: PROF_ index
+* @param ticks: duration in Timer B3 ticks
+*/
+void prof_record(uint8_t vector, uint16_t ticks);
+
+/**
+* clears the statistics
+*/
+void prof_reset();
+
+/**
+* prints count, min, max and histogram for each vector on the debug UART
+*/
+void prof_dump();
+
+/**
+* finds the vector with the most time since the last call and starts over
+*
+* Called from load_window() in the heartbeat task to close a load meter window.
+*
+* @param vector: set to its PROF_ index, left alone if no ISR ran
+* @param us: set to its total time, saturating
+*/
+void prof_window(uint8_t *vector, uint16_t *us);
+
+#else
+
+#define PROF_ENTER(v)
+#define PROF_EXIT(v)
+#define init_profile()
+#define prof_reset()
+#define prof_dump()
+#define prof_window(vector, us)
+
+#endif
+
+#endif
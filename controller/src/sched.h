@@ -0,0 +1,108 @@
+/**
+* @file
+* @brief Header file for the cooperative task scheduler
+*
+* Timer B0 is the one timebase, free running on ACLK so it keeps going while
+* main sleeps in LPM3 with nothing ready. CCR1 ticks SCHED_TICK_HZ times a
+* second, CCR2 is a one-shot for short hardware delays and the overflows
+* extend TB0R to the 32-bit sched_clock(); all share one ISR. Periodic tasks
+* sit in a timer wheel slot by due tick, so a tick only looks at the tasks
+* that could be due.
+* Due tasks, and event tasks posted from ISRs, are marked ready; main runs
+* the highest-priority ready task to completion, then picks again. Ties go
+* to the task added first. An ISR that posts a task wakes main on exit.
+*/
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+#include <msp430fr2355.h>
+
+#ifndef SCHED_TICK_HZ
+#define SCHED_TICK_HZ   100
+#endif
+#if (1000 % SCHED_TICK_HZ) != 0
+#error "SCHED_TICK_HZ must give a whole number of milliseconds"
+#endif
+#define SCHED_TICK_MS   (1000 / SCHED_TICK_HZ)
+#define SCHED_MAX_TASKS 16              // one ready bit each
+#define SCHED_SLOTS     8               // wheel slots, power of 2
+
+typedef void (*TaskFn)(void);
+
+/**
+* one task
+*/
+typedef struct {
+    TaskFn fn;
+    uint16_t period;                    // ticks, 0 = runs only when posted
+    uint16_t due;                       // tick it is next due
+    uint8_t priority;                   // higher runs first
+    uint8_t next;                       // next task in the same wheel slot
+    uint8_t overruns;                   // came due while still ready, saturating
+} Task;
+
+/**
+* adds a task, before sched_start()
+*
+* @param fn: runs to completion each time the task is ready
+* @param period_ms: time between runs, 0 for an event task run by sched_post()
+* @param phase_ms: first run this long after sched_start(), to stagger tasks
+* @param priority: higher runs first when several are ready
+*
+* @return: task id for sched_post()
+*/
+uint8_t sched_add(TaskFn fn, uint16_t period_ms, uint16_t phase_ms, uint8_t priority);
+
+/**
+* marks a task ready; safe from an ISR
+*
+* @param id: from sched_add()
+*/
+void sched_post(uint8_t id);
+
+/**
+* starts Timer B0 free running on ACLK, if it isn't already
+*
+* Called by sched_start(); earlier for anything that needs sched_clock() first.
+*/
+void init_timebase();
+
+/**
+* ACLK counts since init_timebase(); safe from an ISR
+*
+* @return: 1/32768 s counts, wrapping after 36 hours
+*/
+uint32_t sched_clock();
+
+/**
+* starts the tick, keeping the timebase's count
+*/
+void sched_start();
+
+/**
+* calls fn from the timer ISR once, ms from now
+*
+* Replaces any one-shot still pending.
+*
+* @param ms: up to 2000
+* @param fn: keep it short, it runs with interrupts off
+*/
+void sched_oneshot(uint16_t ms, TaskFn fn);
+
+/**
+* drops a pending one-shot
+*/
+void sched_oneshot_cancel();
+
+/**
+* runs ready tasks forever, in LPM3 between them
+*/
+void sched_run();
+
+/**
+* prints each task's overrun count on the debug UART
+*/
+void sched_dump();
+
+#endif
@@ -0,0 +1,59 @@
+/**
+* @file
+* @brief Header file for the binary telemetry stream on the debug UART
+*
+* One frame per record, queued for the UART TX ISR:
+*
+*   0xA5 0x5A | len | payload (len bytes) | CRC-16 low, high
+*
+* CRC-16/CCITT (poly 0x1021, init 0xFFFF) covers len and payload. The
+* payload starts with TELEMETRY_VERSION, then the Telemetry fields in
+* order, 16-bit values little endian. host/tools/teledecode turns a
+* capture into CSV.
+*/
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+#define TELEMETRY_SYNC0     0xA5
+#define TELEMETRY_SYNC1     0x5A
+#define TELEMETRY_VERSION   1
+#define TELEMETRY_PAYLOAD   21          // version + seq + fields below
+#define TELEMETRY_PERIOD    1           // default: every sensor tick (0.5 s)
+
+/**
+* one record of sensor and control state
+*/
+typedef struct {
+    uint16_t elapsed_sec;               // session time
+    uint16_t lm19_raw;                  // last ADC conversion
+    uint16_t lm19_avg;                  // moving average, ADC counts
+    uint16_t lm92_raw;                  // temperature register as read
+    int16_t lm19_centi;                 // filtered ambient, 0.01 C
+    int16_t lm92_centi;                 // plant, 0.01 C
+    uint8_t mode;                       // bits 0-1 LED bar pattern, bit 2 ambient match
+    uint8_t legs;                       // bits 0-1 driven Peltier legs, 2-3 leg waiting on dead time
+    uint8_t i2c_nacks;                  // counters wrap
+    uint8_t bar_resyncs;
+    uint8_t bar_dropped;                // the LED bar's own DROPPED register
+    uint8_t dropped;                    // frames that found the UART queue full
+} Telemetry;
+
+extern uint8_t telemetry_period;       // sensor ticks per frame, 0 = off
+
+/**
+* counts a sensor tick
+*
+* @return: 1 when a frame is due
+*/
+uint8_t telemetry_due();
+
+/**
+* frames a record and queues it, or counts it dropped if the UART is backed up
+*
+* @param t: record; seq, version and dropped are filled in here
+*/
+void telemetry_send(Telemetry *t);
+
+#endif
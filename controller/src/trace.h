@@ -0,0 +1,83 @@
+/**
+* @file
+* @brief Header file for the FRAM event trace
+*
+* A circular log of timestamped events kept in FRAM, so it survives a reset
+* and can be read out after the fact. Timestamps are sched_clock() ACLK
+* counts since boot, 30.5 us apart, so tracing runs on the LPM3 timebase.
+* The 't' debug UART command prints it as hex lines of raw counts;
+* host/tools/tracejson turns those into Chrome trace_event JSON in us.
+* Define NO_TRACE to compile it out.
+*/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <msp430fr2355.h>
+
+#ifndef NO_TRACE
+#define EVENT_TRACE
+#endif
+
+#define TRACE_LEN           512     // records, 6 bytes each
+
+// event types, arg in brackets
+#define TR_BOOT             0x01    // reset seen [0]
+#define TR_ISR_ENTER        0x02    // [PROF_ vector]
+#define TR_ISR_EXIT         0x03    // [PROF_ vector]
+#define TR_I2C_START        0x04    // [slave address]
+#define TR_I2C_STOP         0x05    // [slave address]
+#define TR_I2C_NACK         0x06    // [slave address]
+#define TR_MODE             0x07    // LED bar pattern changed [pattern]
+#define TR_LCD_MODE         0x08    // LCD mode changed [mode]
+#define TR_LCD_BEGIN        0x09    // LCD update started [TR_LCD_ part]
+#define TR_LCD_END          0x0A    // [TR_LCD_ part]
+#define TR_TASK_BEGIN       0x0B    // scheduler task started [task id]
+#define TR_TASK_END         0x0C    // [task id]
+
+// parts of the LCD an update draws
+#define TR_LCD_PART_MODE    0
+#define TR_LCD_PART_TEMP    1
+#define TR_LCD_PART_TIME    2
+
+#ifdef EVENT_TRACE
+
+/**
+* one trace record
+*/
+typedef struct {
+    uint16_t time_lo;               // ACLK counts since boot
+    uint16_t time_hi;
+    uint8_t type;
+    uint8_t arg;
+} TraceRecord;
+
+/**
+* starts the Timer B0 timebase, if sched_start() hasn't yet, and logs TR_BOOT
+*/
+void init_trace();
+
+/**
+* appends one record, overwriting the oldest once full; safe from an ISR
+*
+* @param type: TR_ event
+* @param arg: event argument
+*/
+void trace_log(uint8_t type, uint8_t arg);
+
+/**
+* prints the records oldest first on the debug UART, pausing the log meanwhile
+*/
+void trace_dump();
+
+#define TRACE(type, arg)    trace_log((type), (arg))
+
+#else
+
+#define init_trace()
+#define trace_dump()
+#define TRACE(type, arg)
+
+#endif
+
+#endif
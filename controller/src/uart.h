@@ -0,0 +1,65 @@
+/**
+* @file
+* @brief Header file for the debug UART on the LaunchPad backchannel
+*
+* eUSCI_A1 on P4.3 (TXD) and P4.2 (RXD), 115200 8N1 from SMCLK.
+* Output is queued from main and sent by the TX ISR; single-byte commands
+* are latched by the RX ISR for main.
+*/
+#ifndef UART_H
+#define UART_H
+
+#include <stdint.h>
+#include <msp430fr2355.h>
+
+#define UART_BAUD       115200UL
+#define UART_TX_SIZE    128         // power of 2
+
+extern volatile char uart_cmd;      // last command byte received, cleared by main once handled
+
+/**
+* initializes eUSCI_A1 and its pins, RX interrupt on
+*/
+void init_uart();
+
+/**
+* queues one byte, waiting while the queue is full
+*
+* @param c: byte to send
+*/
+void uart_putc(char c);
+
+/**
+* queues a whole block or none of it, never waiting
+*
+* @param data: bytes to send
+* @param len: byte count
+*
+* @return: 1 if queued, 0 if there wasn't room
+*/
+uint8_t uart_write(const uint8_t *data, uint8_t len);
+
+/**
+* sends a string
+*
+* @param str: null-terminated string
+*/
+void uart_puts(const char *str);
+
+/**
+* sends a number in decimal, right aligned
+*
+* @param value: number to send
+* @param width: minimum field width, padded with spaces
+*/
+void uart_put_u16(uint16_t value, uint8_t width);
+
+/**
+* sends a number in hex, zero padded
+*
+* @param value: number to send
+* @param digits: hex digits to send, low ones last
+*/
+void uart_put_hex(uint16_t value, uint8_t digits);
+
+#endif
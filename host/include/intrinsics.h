@@ -0,0 +1,33 @@
+/**
+* @file
+* @brief Host stand-in for the TI compiler intrinsics
+*
+* Delays and low-power entry hand control to the simulator, which advances
+* simulated time and runs any interrupt service routines that come due.
+*/
+#ifndef INTRINSICS_H
+#define INTRINSICS_H
+
+#include <stdint.h>
+
+#define __interrupt
+
+void sim_delay_cycles(unsigned long cycles);
+void sim_bis_sr(uint16_t bits);
+void sim_bic_sr(uint16_t bits);
+void sim_bic_sr_on_exit(uint16_t bits);
+uint16_t sim_get_sr(void);
+void sim_set_sr(uint16_t sr);
+
+#define __delay_cycles(cycles)          sim_delay_cycles(cycles)
+#define __enable_interrupt()            sim_bis_sr(0x0008)
+#define __disable_interrupt()           sim_bic_sr(0x0008)
+#define __get_interrupt_state()         (sim_get_sr() & 0x0008)
+#define __set_interrupt_state(state)    sim_set_sr((sim_get_sr() & ~0x0008) | ((state) & 0x0008))
+#define __bis_SR_register(bits)         sim_bis_sr(bits)
+#define __bic_SR_register(bits)         sim_bic_sr(bits)
+#define __bic_SR_register_on_exit(bits) sim_bic_sr_on_exit(bits)
+#define __no_operation()                ((void)0)
+#define __even_in_range(value, bound)   (value)
+
+#endif
@@ -0,0 +1,10 @@
+/**
+* @file
+* @brief Host stand-in for the generic TI device header
+*/
+#ifndef MSP430_H
+#define MSP430_H
+
+#include "msp430fr2355.h"
+
+#endif
@@ -0,0 +1,13 @@
+/**
+* @file
+* @brief Host stand-in for the TI MSP430FR2310 device header
+*
+* The slave images only use peripherals the FR2310 shares with the FR2355
+* (Port 1/2, Timer_B0/B1, eUSCI_B0), at the same register names.
+*/
+#ifndef MSP430FR2310_H
+#define MSP430FR2310_H
+
+#include "msp430fr2355.h"
+
+#endif
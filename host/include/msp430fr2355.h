@@ -0,0 +1,399 @@
+/**
+* @file
+* @brief Host stand-in for the TI MSP430FR2355 device header
+*
+* Registers are plain variables owned by the peripheral model in sim/, so the
+* controller sources compile unchanged with a host C compiler. Registers whose
+* reads or writes have side effects on the real part go through accessors.
+*/
+#ifndef MSP430FR2355_H
+#define MSP430FR2355_H
+
+#include <stdint.h>
+#include "intrinsics.h"
+
+#define BIT0                (0x0001)
+#define BIT1                (0x0002)
+#define BIT2                (0x0004)
+#define BIT3                (0x0008)
+#define BIT4                (0x0010)
+#define BIT5                (0x0020)
+#define BIT6                (0x0040)
+#define BIT7                (0x0080)
+#define BIT8                (0x0100)
+#define BIT9                (0x0200)
+#define BITA                (0x0400)
+#define BITB                (0x0800)
+#define BITC                (0x1000)
+#define BITD                (0x2000)
+#define BITE                (0x4000)
+#define BITF                (0x8000)
+
+// status register
+#define GIE                 (0x0008)
+#define CPUOFF              (0x0010)
+#define OSCOFF              (0x0020)
+#define SCG0                (0x0040)
+#define SCG1                (0x0080)
+#define LPM0_bits           (CPUOFF)
+#define LPM1_bits           (SCG0 + CPUOFF)
+#define LPM3_bits           (SCG1 + SCG0 + CPUOFF)
+#define LPM4_bits           (SCG1 + SCG0 + OSCOFF + CPUOFF)
+
+//-- watchdog, power management -----------------------
+extern volatile uint16_t WDTCTL;
+#define WDTPW               (0x5A00)
+#define WDTHOLD             (0x0080)
+
+extern volatile uint16_t PM5CTL0;
+#define LOCKLPM5            (0x0001)
+
+// FRAM write protection; the model has no protected memory, so this is only stored
+extern volatile uint16_t SYSCFG0;
+#define FRWPPW              (0xA500)
+#define DFWP                (0x0002)
+#define PFWP                (0x0001)
+
+//-- clock system, FRAM controller -----------------------
+// the model derives MCLK and SMCLK from these; the FLL locks at once
+extern volatile uint16_t CSCTL0, CSCTL1, CSCTL2, CSCTL3, CSCTL4, CSCTL5, CSCTL6, CSCTL7, CSCTL8;
+#define DCORSEL             (0x000E)
+#define DCORSEL_0           (0x0000)
+#define DCORSEL_1           (0x0002)
+#define DCORSEL_2           (0x0004)
+#define DCORSEL_3           (0x0006)
+#define DCORSEL_4           (0x0008)
+#define DCORSEL_5           (0x000A)
+#define DCORSEL_6           (0x000C)
+#define DCORSEL_7           (0x000E)
+#define FLLN                (0x03FF)
+#define FLLD                (0x7000)
+#define FLLD_0              (0x0000)
+#define FLLD_1              (0x1000)
+#define SELREF              (0x0030)
+#define SELREF__REFOCLK     (0x0010)
+#define SELMS               (0x0007)
+#define SELMS__DCOCLKDIV    (0x0000)
+#define SELMS__REFOCLK      (0x0001)
+#define SELA                (0x0300)
+#define SELA__REFOCLK       (0x0100)
+#define DIVM                (0x0007)
+#define DIVM__1             (0x0000)
+#define DIVS                (0x0030)
+#define DIVS__1             (0x0000)
+#define FLLUNLOCK0          (0x0100)
+#define FLLUNLOCK1          (0x0200)
+
+extern volatile uint16_t FRCTL0;
+#define FRCTLPW             (0xA500)
+#define NWAITS              (0x0070)
+#define NWAITS_0            (0x0000)
+#define NWAITS_1            (0x0010)
+#define NWAITS_2            (0x0020)
+
+//-- digital I/O ---------------------------------------
+typedef struct {
+    uint8_t in, out, dir, ren, sel0, sel1, ies, ie, ifg;
+} sim_port_t;
+extern sim_port_t sim_port[7];              // index 1..6 = P1..P6
+
+#define P1IN                (sim_port_in(1))
+#define P1OUT               (sim_port[1].out)
+#define P1DIR               (sim_port[1].dir)
+#define P1REN               (sim_port[1].ren)
+#define P1SEL0              (sim_port[1].sel0)
+#define P1SEL1              (sim_port[1].sel1)
+#define P1IES               (sim_port[1].ies)
+#define P1IE                (sim_port[1].ie)
+#define P1IFG               (sim_port[1].ifg)
+#define P2IN                (sim_port_in(2))
+#define P2OUT               (sim_port[2].out)
+#define P2DIR               (sim_port[2].dir)
+#define P2REN               (sim_port[2].ren)
+#define P2SEL0              (sim_port[2].sel0)
+#define P2SEL1              (sim_port[2].sel1)
+#define P2IES               (sim_port[2].ies)
+#define P2IE                (sim_port[2].ie)
+#define P2IFG               (sim_port[2].ifg)
+#define P3IN                (sim_port_in(3))
+#define P3OUT               (sim_port[3].out)
+#define P3DIR               (sim_port[3].dir)
+#define P3REN               (sim_port[3].ren)
+#define P3SEL0              (sim_port[3].sel0)
+#define P3SEL1              (sim_port[3].sel1)
+#define P4IN                (sim_port_in(4))
+#define P4OUT               (sim_port[4].out)
+#define P4DIR               (sim_port[4].dir)
+#define P4REN               (sim_port[4].ren)
+#define P4SEL0              (sim_port[4].sel0)
+#define P4SEL1              (sim_port[4].sel1)
+#define P4IES               (sim_port[4].ies)
+#define P4IE                (sim_port[4].ie)
+#define P4IFG               (sim_port[4].ifg)
+#define P5IN                (sim_port_in(5))
+#define P5OUT               (sim_port[5].out)
+#define P5DIR               (sim_port[5].dir)
+#define P5REN               (sim_port[5].ren)
+#define P5SEL0              (sim_port[5].sel0)
+#define P5SEL1              (sim_port[5].sel1)
+#define P6IN                (sim_port_in(6))
+#define P6OUT               (sim_port[6].out)
+#define P6DIR               (sim_port[6].dir)
+#define P6REN               (sim_port[6].ren)
+#define P6SEL0              (sim_port[6].sel0)
+#define P6SEL1              (sim_port[6].sel1)
+
+#define P1IV                (sim_port_iv(1))
+#define P2IV                (sim_port_iv(2))
+#define P3IV                (sim_port_iv(3))
+#define P4IV                (sim_port_iv(4))
+#define P1IV__NONE          (0x0000)
+#define P1IV__P1IFG0        (0x0002)
+#define P1IV__P1IFG1        (0x0004)
+#define P1IV__P1IFG2        (0x0006)
+#define P1IV__P1IFG3        (0x0008)
+#define P1IV__P1IFG4        (0x000A)
+#define P1IV__P1IFG5        (0x000C)
+#define P1IV__P1IFG6        (0x000E)
+#define P1IV__P1IFG7        (0x0010)
+#define P2IV__NONE          (0x0000)
+#define P2IV__P2IFG0        (0x0002)
+#define P2IV__P2IFG1        (0x0004)
+#define P2IV__P2IFG2        (0x0006)
+#define P2IV__P2IFG3        (0x0008)
+#define P2IV__P2IFG4        (0x000A)
+#define P2IV__P2IFG5        (0x000C)
+#define P2IV__P2IFG6        (0x000E)
+#define P2IV__P2IFG7        (0x0010)
+#define P3IV__NONE          (0x0000)
+#define P3IV__P3IFG0        (0x0002)
+#define P3IV__P3IFG1        (0x0004)
+#define P3IV__P3IFG2        (0x0006)
+#define P3IV__P3IFG3        (0x0008)
+#define P3IV__P3IFG4        (0x000A)
+#define P3IV__P3IFG5        (0x000C)
+#define P3IV__P3IFG6        (0x000E)
+#define P3IV__P3IFG7        (0x0010)
+#define P4IV__NONE          (0x0000)
+#define P4IV__P4IFG0        (0x0002)
+#define P4IV__P4IFG1        (0x0004)
+#define P4IV__P4IFG2        (0x0006)
+#define P4IV__P4IFG3        (0x0008)
+#define P4IV__P4IFG4        (0x000A)
+#define P4IV__P4IFG5        (0x000C)
+#define P4IV__P4IFG6        (0x000E)
+#define P4IV__P4IFG7        (0x0010)
+
+uint8_t sim_port_in(int port);
+uint16_t sim_port_iv(int port);
+
+//-- Timer_B --------------------------------------------
+typedef struct {
+    uint16_t ctl, r, ex0;
+    uint16_t cctl[7];
+    uint16_t ccr[7];
+} sim_timer_t;
+extern sim_timer_t sim_tb[4];
+
+#define TB0CTL              (sim_tb[0].ctl)
+#define TB0R                (sim_tb[0].r)
+#define TB0EX0              (sim_tb[0].ex0)
+#define TB0IV               (sim_tb_iv(0))
+#define TB0CCTL0            (sim_tb[0].cctl[0])
+#define TB0CCTL1            (sim_tb[0].cctl[1])
+#define TB0CCTL2            (sim_tb[0].cctl[2])
+#define TB0CCR0             (sim_tb[0].ccr[0])
+#define TB0CCR1             (sim_tb[0].ccr[1])
+#define TB0CCR2             (sim_tb[0].ccr[2])
+#define TB1CTL              (sim_tb[1].ctl)
+#define TB1R                (sim_tb[1].r)
+#define TB1EX0              (sim_tb[1].ex0)
+#define TB1IV               (sim_tb_iv(1))
+#define TB1CCTL0            (sim_tb[1].cctl[0])
+#define TB1CCTL1            (sim_tb[1].cctl[1])
+#define TB1CCTL2            (sim_tb[1].cctl[2])
+#define TB1CCR0             (sim_tb[1].ccr[0])
+#define TB1CCR1             (sim_tb[1].ccr[1])
+#define TB1CCR2             (sim_tb[1].ccr[2])
+#define TB2CTL              (sim_tb[2].ctl)
+#define TB2R                (sim_tb[2].r)
+#define TB2EX0              (sim_tb[2].ex0)
+#define TB2IV               (sim_tb_iv(2))
+#define TB2CCTL0            (sim_tb[2].cctl[0])
+#define TB2CCTL1            (sim_tb[2].cctl[1])
+#define TB2CCTL2            (sim_tb[2].cctl[2])
+#define TB2CCR0             (sim_tb[2].ccr[0])
+#define TB2CCR1             (sim_tb[2].ccr[1])
+#define TB2CCR2             (sim_tb[2].ccr[2])
+#define TB3CTL              (sim_tb[3].ctl)
+#define TB3R                (sim_tb[3].r)
+#define TB3EX0              (sim_tb[3].ex0)
+#define TB3IV               (sim_tb_iv(3))
+#define TB3CCTL0            (sim_tb[3].cctl[0])
+#define TB3CCTL1            (sim_tb[3].cctl[1])
+#define TB3CCTL2            (sim_tb[3].cctl[2])
+#define TB3CCTL3            (sim_tb[3].cctl[3])
+#define TB3CCTL4            (sim_tb[3].cctl[4])
+#define TB3CCTL5            (sim_tb[3].cctl[5])
+#define TB3CCTL6            (sim_tb[3].cctl[6])
+#define TB3CCR0             (sim_tb[3].ccr[0])
+#define TB3CCR1             (sim_tb[3].ccr[1])
+#define TB3CCR2             (sim_tb[3].ccr[2])
+#define TB3CCR3             (sim_tb[3].ccr[3])
+#define TB3CCR4             (sim_tb[3].ccr[4])
+#define TB3CCR5             (sim_tb[3].ccr[5])
+#define TB3CCR6             (sim_tb[3].ccr[6])
+
+uint16_t sim_tb_iv(int timer);
+
+#define TBIFG               (0x0001)
+#define TBIE                (0x0002)
+#define TBCLR               (0x0004)
+#define MC                  (0x0030)
+#define MC__STOP            (0x0000)
+#define MC__UP              (0x0010)
+#define MC__CONTINUOUS      (0x0020)
+#define MC__UPDOWN          (0x0030)
+#define ID                  (0x00C0)
+#define ID__1               (0x0000)
+#define ID__2               (0x0040)
+#define ID__4               (0x0080)
+#define ID__8               (0x00C0)
+#define TBSSEL              (0x0300)
+#define TBSSEL__TBCLK       (0x0000)
+#define TBSSEL__ACLK        (0x0100)
+#define TBSSEL__SMCLK       (0x0200)
+#define TBIDEX              (0x0007)
+#define TBIDEX__1           (0x0000)
+#define TBIDEX__2           (0x0001)
+#define TBIDEX__3           (0x0002)
+#define TBIDEX__4           (0x0003)
+#define TBIDEX__5           (0x0004)
+#define TBIDEX__6           (0x0005)
+#define TBIDEX__7           (0x0006)
+#define TBIDEX__8           (0x0007)
+
+#define CCIFG               (0x0001)
+#define COV                 (0x0002)
+#define OUT                 (0x0004)
+#define CCIE                (0x0010)
+#define OUTMOD              (0x00E0)
+#define OUTMOD_0            (0x0000)
+#define OUTMOD_7            (0x00E0)
+#define CAP                 (0x0100)
+
+#define TBIV_NONE           (0x0000)
+#define TBIV__TBCCR1        (0x0002)
+#define TBIV__TBCCR2        (0x0004)
+#define TBIV__TBCCR3        (0x0006)
+#define TBIV__TBCCR4        (0x0008)
+#define TBIV__TBCCR5        (0x000A)
+#define TBIV__TBCCR6        (0x000C)
+#define TBIV__TBIFG         (0x000E)
+
+//-- eUSCI_B0 (I2C) -------------------------------------
+extern volatile uint16_t sim_ucb0ctlw0, UCB0CTLW1, UCB0BRW, sim_ucb0statw, UCB0TBCNT, UCB0I2COA0, UCB0I2CSA,
+    UCB0IE, UCB0IFG;
+extern volatile uint16_t UCB0RXBUF, UCB0TXBUF;
+volatile uint16_t *sim_ucb0ctlw0_access(void);
+volatile uint16_t *sim_ucb0statw_access(void);
+uint16_t sim_ucb0iv(void);
+
+// every access to the control word lets a pending START or STOP take effect
+#define UCB0CTLW0           (*sim_ucb0ctlw0_access())
+#define UCB0CTL1            (*(volatile uint8_t *)sim_ucb0ctlw0_access())
+// and polling UCBBUSY lets the transfer on the bus run on
+#define UCB0STATW           (*sim_ucb0statw_access())
+#define UCB0IV              (sim_ucb0iv())
+
+#define UCSWRST             (0x0001)
+#define UCTXSTT             (0x0002)
+#define UCTXSTP             (0x0004)
+#define UCTXNACK            (0x0008)
+#define UCTR                (0x0010)
+#define UCSSEL__UCLK        (0x0000)
+#define UCSSEL__ACLK        (0x0040)
+#define UCSSEL__SMCLK       (0x0080)
+#define UCSYNC              (0x0100)
+#define UCMODE_3            (0x0600)
+#define UCMST               (0x0800)
+
+#define UCASTP_0            (0x0000)
+#define UCASTP_1            (0x0004)
+#define UCASTP_2            (0x0008)
+
+#define UCBBUSY             (0x0010)
+#define UCOAEN              (0x0400)
+
+#define UCRXIE0             (0x0001)
+#define UCTXIE0             (0x0002)
+#define UCSTTIE             (0x0004)
+#define UCSTPIE             (0x0008)
+#define UCALIE              (0x0010)
+#define UCNACKIE            (0x0020)
+#define UCBCNTIE            (0x0040)
+#define UCRXIFG0            (0x0001)
+#define UCTXIFG0            (0x0002)
+#define UCSTTIFG            (0x0004)
+#define UCSTPIFG            (0x0008)
+#define UCALIFG             (0x0010)
+#define UCNACKIFG           (0x0020)
+#define UCBCNTIFG           (0x0040)
+
+#define USCI_NONE           (0x0000)
+#define USCI_I2C_UCALIFG    (0x0002)
+#define USCI_I2C_UCNACKIFG  (0x0004)
+#define USCI_I2C_UCSTTIFG   (0x0006)
+#define USCI_I2C_UCSTPIFG   (0x0008)
+#define USCI_I2C_UCRXIFG0   (0x0016)
+#define USCI_I2C_UCTXIFG0   (0x0018)
+#define USCI_I2C_UCBCNTIFG  (0x001A)
+
+//-- eUSCI_A1 (UART) ------------------------------------
+extern volatile uint16_t sim_uca1ifg, UCA1CTLW0, UCA1BRW, UCA1MCTLW, UCA1STATW, UCA1IE;
+extern volatile uint16_t sim_uca1rxbuf, sim_uca1txbuf;
+volatile uint16_t *sim_uca1ifg_access(void);
+volatile uint16_t *sim_uca1txbuf_access(void);
+uint16_t sim_uca1rxbuf_read(void);
+uint16_t sim_uca1iv(void);
+
+// polling IFG waits for the transmitter; a TXBUF access is a write and hands it the byte
+#define UCA1IFG             (*sim_uca1ifg_access())
+#define UCA1TXBUF           (*sim_uca1txbuf_access())
+#define UCA1RXBUF           (sim_uca1rxbuf_read())
+#define UCA1IV              (sim_uca1iv())
+
+#define UCOS16              (0x0001)
+#define UCBRF               (0x00F0)
+#define UCBRS               (0xFF00)
+
+#define UCRXIE              (0x0001)
+#define UCTXIE              (0x0002)
+#define UCRXIFG             (0x0001)
+#define UCTXIFG             (0x0002)
+
+#define USCI_UART_UCRXIFG   (0x0002)
+#define USCI_UART_UCTXIFG   (0x0004)
+
+//-- ADC --------------------------------------------------
+extern volatile uint16_t ADCCTL0, ADCCTL1, ADCCTL2, ADCMCTL0, ADCMEM0, ADCIE, ADCIFG;
+
+#define ADCSC               (0x0001)
+#define ADCENC              (0x0002)
+#define ADCON               (0x0010)
+#define ADCSHT              (0x0F00)
+#define ADCSHT_2            (0x0200)
+#define ADCSSEL_2           (0x0010)
+#define ADCDIV              (0x00E0)
+#define ADCSHP              (0x0200)
+#define ADCSHS              (0x0C00)
+#define ADCSHS_1            (0x0400)
+#define ADCCONSEQ           (0x0006)
+#define ADCCONSEQ_2         (0x0004)
+#define ADCRES              (0x0030)
+#define ADCRES_2            (0x0020)
+#define ADCINCH_1           (0x0001)
+#define ADCIE0              (0x0001)
+#define ADCIFG0             (0x0001)
+
+#endif
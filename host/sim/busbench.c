@@ -0,0 +1,265 @@
+/**
+* @file
+* @brief Controller I2C bus load at each SCL rate
+*
+* Drives the simulated eUSCI_B0 master the way the controller does (autostop
+* on TBCNT, one byte per TX or RX interrupt) through the controller's periodic
+* traffic: LM92 reads, LED bar pattern writes and status polls, the DS3231
+* resync and LCD slave updates in its byte and frame protocols. Every periodic
+* transfer is due at t = 0, so the first tick is the worst case burst.
+*
+* For each SCL rate it reports transfers and bytes per second with the bus
+* never idle, the share of the bus the real rates use, and the longest any
+* transfer waited from due to STOP. Only bus time is counted: ISRs take no
+* simulated time and the model's slaves never stretch the clock.
+*
+* usage: busbench [seconds] [scl_hz ...]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <msp430.h>
+#include "common/clock.h"
+#include "devices.h"
+#include "sim.h"
+
+#define LCD_ADDR            0x0B
+#define FRAME_CMD           0xF0
+#define MAX_OPS             16
+
+typedef struct {
+    const char *name;
+    uint8_t addr;
+    const uint8_t *tx;                  // written first, if tx_len
+    uint8_t tx_len;
+    uint8_t rx_len;                     // then read in a second transfer
+    uint32_t period_ms;
+} op_t;
+
+static const uint8_t bar_mode[] = {LED_BAR_MODE, 3};
+static const uint8_t bar_period[] = {0x02, 64};              // BAR_PERIOD
+static const uint8_t bar_status[] = {LED_BAR_STATUS};
+static const uint8_t rtc_time[] = {0x00};
+static const uint8_t lcd_temp[] = {'2', '4', '5'};
+static uint8_t lcd_frame[33] = {FRAME_CMD};
+
+// in queue order when due together, see task_sense() and task_bar_poll()
+static const op_t ops[] = {
+    {"lm92",       LM92_ADDR,    NULL,       0,                  2,   500},
+    {"rtc",        DS3231_ADDR,  rtc_time,   sizeof(rtc_time),   3, 60000},
+    {"bar_status", LED_BAR_ADDR, bar_status, sizeof(bar_status), 6,   500},
+    {"bar_mode",   LED_BAR_ADDR, bar_mode,   sizeof(bar_mode),   0,  1000},
+    {"bar_period", LED_BAR_ADDR, bar_period, sizeof(bar_period), 0,  1000},
+    {"lcd_ambient", LCD_ADDR,    lcd_temp,   sizeof(lcd_temp),   0,   500},
+    {"lcd_plant",  LCD_ADDR,     lcd_temp,   sizeof(lcd_temp),   0,   500},
+    {"lcd_frame",  LCD_ADDR,     lcd_frame,  sizeof(lcd_frame),  0,  1000},
+};
+#define OP_COUNT    (sizeof(ops) / sizeof(ops[0]))
+
+static struct {
+    uint32_t hz;
+    const uint8_t *tx;
+    uint8_t *rx;
+    uint8_t idx;
+    volatile uint8_t done;
+    unsigned nacks;
+} bus;
+
+static struct {
+    uint64_t next_due[MAX_OPS];         // ps
+    uint64_t worst_ps[MAX_OPS];         // due to STOP
+    uint64_t busy_ps;                   // START to STOP, summed
+    unsigned long xfers, bytes;
+} stats;
+
+//-- bench firmware -----------------------------------
+
+static void bench_i2c_isr(void)
+{
+    switch(UCB0IV)
+    {
+        case USCI_I2C_UCNACKIFG:
+            ++bus.nacks;
+            bus.done = 1;
+            __bic_SR_register_on_exit(LPM0_bits);
+            break;
+        case USCI_I2C_UCSTPIFG:
+            bus.done = 1;
+            __bic_SR_register_on_exit(LPM0_bits);
+            break;
+        case USCI_I2C_UCRXIFG0:
+            bus.rx[bus.idx++] = UCB0RXBUF;
+            break;
+        case USCI_I2C_UCTXIFG0:
+            UCB0TXBUF = bus.tx[bus.idx++];
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+* one transfer with autostop, sleeping in LPM0 until STOP or NACK
+*/
+static void transfer(uint8_t addr, const uint8_t *tx, uint8_t *rx, uint8_t len)
+{
+    bus.tx = tx;
+    bus.rx = rx;
+    bus.idx = 0;
+    bus.done = 0;
+    UCB0TBCNT = len;
+    UCB0I2CSA = addr;
+    if(tx)
+    {
+        UCB0CTLW0 |= UCTR | UCTXSTT;
+    }
+    else
+    {
+        UCB0CTLW0 &= ~UCTR;
+        UCB0CTLW0 |= UCTXSTT;
+    }
+    __disable_interrupt();
+    while(!bus.done)
+    {
+        __bis_SR_register(LPM0_bits | GIE);
+        __disable_interrupt();
+    }
+    __enable_interrupt();
+}
+
+static int bench_main(void)
+{
+    uint8_t rx[8];
+    unsigned i;
+
+    WDTCTL = WDTPW | WDTHOLD;
+    init_clock();
+
+    UCB0CTLW0 |= UCSWRST;
+    UCB0CTLW0 |= UCMODE_3 | UCMST;                    // I2C master, SMCLK
+    UCB0CTLW1 |= UCASTP_2;                            // automatic STOP at TBCNT
+    UCB0BRW = I2C_BRW(bus.hz);
+    UCB0CTLW0 &= ~UCSWRST;
+    UCB0IE |= UCTXIE0 | UCRXIE0 | UCSTPIE | UCNACKIE;
+    __enable_interrupt();
+
+    while(1)
+    {
+        // earliest due, table order on ties
+        unsigned next = 0;
+        for(i = 1; i < OP_COUNT; i++)
+        {
+            if(stats.next_due[i] < stats.next_due[next])
+            {
+                next = i;
+            }
+        }
+        if(stats.next_due[next] > sim_now)
+        {
+            __delay_cycles((unsigned long)((stats.next_due[next] - sim_now) / (SIM_PS_PER_S / F_CPU)) + 1);
+            continue;
+        }
+
+        const op_t *op = &ops[next];
+        uint64_t start = sim_now;
+        if(op->tx_len)
+        {
+            transfer(op->addr, op->tx, NULL, op->tx_len);
+            ++stats.xfers;
+        }
+        if(op->rx_len)
+        {
+            transfer(op->addr, NULL, rx, op->rx_len);
+            ++stats.xfers;
+        }
+        stats.bytes += op->tx_len + op->rx_len;
+        stats.busy_ps += sim_now - start;
+
+        uint64_t wait = sim_now - stats.next_due[next];
+        if(wait > stats.worst_ps[next])
+        {
+            stats.worst_ps[next] = wait;
+        }
+        stats.next_due[next] += (uint64_t)op->period_ms * (SIM_PS_PER_S / 1000);
+    }
+    return 0;
+}
+
+//-- host ---------------------------------------------
+
+static void lcd_write(void *ctx, uint8_t byte)
+{
+    (void)ctx;
+    (void)byte;
+}
+
+int main(int argc, char **argv)
+{
+    static const uint32_t default_hz[] = {100000, 125000, 200000, 400000};
+    double seconds = (argc > 1) ? atof(argv[1]) : 60.0;
+    int speeds = (argc > 2) ? argc - 2 : (int)(sizeof(default_hz) / sizeof(default_hz[0]));
+    int s;
+    unsigned i;
+
+    for(i = 1; i < sizeof(lcd_frame); i++)
+    {
+        lcd_frame[i] = ' ';
+    }
+
+    printf("%8s %5s %12s %12s %8s %10s  %s\n",
+           "scl_hz", "brw", "xfers_per_s", "bytes_per_s", "util_%", "worst_ms", "worst_op");
+    for(s = 0; s < speeds; s++)
+    {
+        plant_params_t params;
+        plant_t plant;
+        lm92_t lm92;
+        ds3231_t rtc;
+        ledbar_t ledbar;
+        static const sim_i2c_dev_t lcd = {LCD_ADDR, NULL, NULL, lcd_write, NULL, NULL};
+
+        memset(&bus, 0, sizeof(bus));
+        memset(&stats, 0, sizeof(stats));
+        bus.hz = (argc > 2) ? (uint32_t)atol(argv[2 + s]) : default_hz[s];
+        if((bus.hz == 0) || (bus.hz > 400000))
+        {
+            fprintf(stderr, "busbench: %s Hz is not a standard or fast mode rate\n", argv[2 + s]);
+            return 2;
+        }
+
+        sim_reset();
+        plant_defaults(&params);
+        plant_init(&plant, &params, 1);
+        lm92_attach(&lm92, &plant);
+        ds3231_attach(&rtc, 0, 0);
+        ledbar_attach(&ledbar);
+        sim_i2c_attach(&lcd);
+        sim_attach_isr(SIM_VEC_EUSCI_B0, bench_i2c_isr);
+        if(sim_run(bench_main, seconds) != 0)
+        {
+            fprintf(stderr, "busbench: bench image stopped at %u Hz\n", (unsigned)bus.hz);
+            return 2;
+        }
+        if(bus.nacks)
+        {
+            fprintf(stderr, "busbench: %u NACKs at %u Hz\n", bus.nacks, (unsigned)bus.hz);
+            return 2;
+        }
+
+        uint64_t worst = 0;
+        const char *worst_op = "";
+        for(i = 0; i < OP_COUNT; i++)
+        {
+            if(stats.worst_ps[i] > worst)
+            {
+                worst = stats.worst_ps[i];
+                worst_op = ops[i].name;
+            }
+        }
+        double busy = (double)stats.busy_ps / SIM_PS_PER_S;
+        printf("%8u %5u %12.0f %12.0f %8.2f %10.3f  %s\n", (unsigned)bus.hz, (unsigned)UCB0BRW,
+               stats.xfers / busy, stats.bytes / busy, 100.0 * busy / seconds,
+               (double)worst * 1e3 / SIM_PS_PER_S, worst_op);
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+/**
+* @file
+* @brief Session config files for the host simulator
+*/
+#include <ctype.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+
+static const struct {
+    const char *name;
+    size_t offset;
+} plant_keys[] = {
+    { "thermal_mass", offsetof(plant_params_t, thermal_mass) },
+    { "peltier_heat", offsetof(plant_params_t, peltier_heat) },
+    { "peltier_cool", offsetof(plant_params_t, peltier_cool) },
+    { "peltier_power", offsetof(plant_params_t, peltier_power) },
+    { "ambient_coupling", offsetof(plant_params_t, ambient_coupling) },
+    { "ambient_temp", offsetof(plant_params_t, ambient_temp) },
+    { "initial_temp", offsetof(plant_params_t, initial_temp) },
+    { "lm92_lag", offsetof(plant_params_t, lm92_lag) },
+    { "lm92_noise", offsetof(plant_params_t, lm92_noise) },
+    { "lm19_noise", offsetof(plant_params_t, lm19_noise) },
+    { "settle_band", offsetof(plant_params_t, settle_band) },
+};
+
+void config_defaults(sim_config_t *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    plant_defaults(&cfg->plant);
+    cfg->duration = 300;
+    cfg->seed = 1;
+    cfg->presses[0].time = 0.5;
+    cfg->presses[0].key = 'C';
+    cfg->press_count = 1;
+}
+
+static int parse_double(const char *value, double *out)
+{
+    char *end;
+    *out = strtod(value, &end);
+    return (end != value) ? 0 : -1;
+}
+
+int config_set(sim_config_t *cfg, const char *key, const char *value)
+{
+    size_t k;
+    for(k = 0; k < sizeof(plant_keys) / sizeof(plant_keys[0]); ++k)
+    {
+        if(strcmp(key, plant_keys[k].name) == 0)
+        {
+            return parse_double(value, (double *)((char *)&cfg->plant + plant_keys[k].offset));
+        }
+    }
+    if(strcmp(key, "duration") == 0)
+    {
+        return parse_double(value, &cfg->duration);
+    }
+    if(strcmp(key, "seed") == 0)
+    {
+        cfg->seed = strtoull(value, NULL, 0);
+        return 0;
+    }
+    if(strcmp(key, "press") == 0)
+    {
+        key_press_t press;
+        if((sscanf(value, "%lf %c", &press.time, &press.key) != 2) || (cfg->press_count == MAX_PRESSES))
+        {
+            return -1;
+        }
+        cfg->presses[cfg->press_count++] = press;
+        return 0;
+    }
+    if(strcmp(key, "uart") == 0)
+    {
+        key_press_t cmd;
+        if((sscanf(value, "%lf %c", &cmd.time, &cmd.key) != 2) || (cfg->uart_count == MAX_PRESSES))
+        {
+            return -1;
+        }
+        cfg->uart_cmds[cfg->uart_count++] = cmd;
+        return 0;
+    }
+    return -1;
+}
+
+static char *trim(char *s)
+{
+    while(isspace((unsigned char)*s))
+    {
+        ++s;
+    }
+    char *end = s + strlen(s);
+    while((end > s) && isspace((unsigned char)end[-1]))
+    {
+        *--end = '\0';
+    }
+    return s;
+}
+
+int config_load(sim_config_t *cfg, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if(f == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    char line[256];
+    int line_no = 0, ret = 0, presses_seen = 0;
+    while(fgets(line, sizeof(line), f))
+    {
+        ++line_no;
+        char *hash = strchr(line, '#');
+        if(hash)
+        {
+            *hash = '\0';
+        }
+        char *eq = strchr(line, '=');
+        if(eq == NULL)
+        {
+            if(*trim(line) != '\0')
+            {
+                fprintf(stderr, "%s:%d: expected key = value\n", path, line_no);
+                ret = -1;
+            }
+            continue;
+        }
+        *eq = '\0';
+        char *key = trim(line), *value = trim(eq + 1);
+
+        // a file's presses replace the default script rather than adding to it
+        if((strcmp(key, "press") == 0) && !presses_seen++)
+        {
+            cfg->press_count = 0;
+        }
+        if(config_set(cfg, key, value) != 0)
+        {
+            fprintf(stderr, "%s:%d: bad setting '%s'\n", path, line_no, key);
+            ret = -1;
+        }
+    }
+    fclose(f);
+    return ret;
+}
@@ -0,0 +1,57 @@
+/**
+* @file
+* @brief Session config files for the host simulator
+*
+* Plain "key = value" lines; '#' starts a comment. Any plant_params_t field
+* may be given by name, plus the session keys below:
+*
+*   duration = 300          simulated seconds
+*   seed = 1                sensor noise seed
+*   press = 0.5 C           key pressed at 0.5 s (held KEY_HOLD s), repeatable
+*   uart = 299 p            byte sent to the debug UART at 299 s, repeatable
+*/
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdint.h>
+
+#include "plant.h"
+
+#define MAX_PRESSES         16
+#define KEY_HOLD            0.3             // s a scripted key stays down
+
+typedef struct {
+    double time;
+    char key;
+} key_press_t;
+
+typedef struct {
+    plant_params_t plant;
+    double duration;
+    uint64_t seed;
+    key_press_t presses[MAX_PRESSES];
+    int press_count;
+    key_press_t uart_cmds[MAX_PRESSES];     // same shape: a time and a byte
+    int uart_count;
+} sim_config_t;
+
+/**
+* fills in the defaults: 300 s session, ambient-match selected at 0.5 s
+*/
+void config_defaults(sim_config_t *cfg);
+
+/**
+* applies one "key = value" setting
+*
+* @return: 0 on success, -1 for an unknown key or bad value
+*/
+int config_set(sim_config_t *cfg, const char *key, const char *value);
+
+/**
+* reads a config file on top of whatever cfg already holds
+*
+* @return: 0 on success, -1 on error (reported on stderr)
+*/
+int config_load(sim_config_t *cfg, const char *path);
+
+#endif
@@ -0,0 +1,162 @@
+/**
+* @file
+* @brief Glue between the simulator and the controller firmware image
+*/
+#include "msp430fr2355.h"
+#include "src/keypad.h"
+
+#include "controller.h"
+#include "devices.h"
+#include "sim.h"
+
+#define PLANT_DT            0.01            // s per plant integration step
+#define TRACE_EVERY         10              // plant steps per trace row
+
+// controller ISRs, see controller/app/main.c
+void transmit_data(void);
+void sched_tick(void);
+void record_av(void);
+void rtc_tick(void);
+void uart_data(void);
+
+extern Keypad keypad;
+extern uint8_t window_size;
+
+static char held_key;
+
+static struct {
+    const sim_config_t *cfg;
+    plant_t plant;
+    lm92_t lm92;
+    ds3231_t rtc;
+    ledbar_t ledbar;
+    FILE *trace;
+    FILE *console;
+    unsigned steps;
+} session;
+
+void controller_attach_isrs(void)
+{
+    sim_attach_isr(SIM_VEC_TIMER0_B1, sched_tick);
+    sim_attach_isr(SIM_VEC_EUSCI_B0, transmit_data);
+    sim_attach_isr(SIM_VEC_ADC, record_av);
+    sim_attach_isr(SIM_VEC_PORT2, rtc_tick);
+    sim_attach_isr(SIM_VEC_EUSCI_A1, uart_data);
+}
+
+/**
+* keypad rows read low only while the held key's column is driven low
+*/
+static uint8_t keypad_rows(void *ctx, int port)
+{
+    (void)ctx;
+    sim_port_t *rows = &sim_port[port], *cols = &sim_port[2];
+    uint8_t in = rows->ren & rows->out;
+    int r, c;
+
+    for(r = 0; held_key && (r < 4); ++r)
+    {
+        for(c = 0; c < 4; ++c)
+        {
+            uint8_t col = (uint8_t)keypad.col_pins[c];
+            if((key_chars[r][c] == held_key) && (cols->dir & col) && !(cols->out & col))
+            {
+                in &= (uint8_t)~keypad.row_pins[r];
+            }
+        }
+    }
+    return (uint8_t)((rows->dir & rows->out) | (~rows->dir & in));
+}
+
+void controller_set_window(uint8_t window)
+{
+    window_size = window;
+}
+
+void controller_hold_key(char key)
+{
+    held_key = key;
+}
+
+void controller_set_console(FILE *console)
+{
+    session.console = console;
+}
+
+static void console_tx(void *ctx, uint8_t byte)
+{
+    (void)ctx;
+    if(session.console)
+    {
+        fputc(byte, session.console);
+    }
+}
+
+static uint16_t lm19_sample(void *ctx, int channel)
+{
+    (void)channel;
+    return plant_lm19_counts(ctx);
+}
+
+static void plant_tick(void *ctx)
+{
+    (void)ctx;
+    double now = sim_seconds();
+    int k;
+
+    plant_step(&session.plant, PLANT_DT, sim_port[6].out);
+
+    controller_hold_key(0);
+    for(k = 0; k < session.cfg->press_count; ++k)
+    {
+        const key_press_t *press = &session.cfg->presses[k];
+        if((now >= press->time) && (now < press->time + KEY_HOLD))
+        {
+            if(now < press->time + PLANT_DT)
+            {
+                plant_start_metrics(&session.plant, now);
+            }
+            controller_hold_key(press->key);
+        }
+    }
+    for(k = 0; k < session.cfg->uart_count; ++k)
+    {
+        const key_press_t *cmd = &session.cfg->uart_cmds[k];
+        if((now >= cmd->time) && (now < cmd->time + PLANT_DT))
+        {
+            sim_uart_rx((uint8_t)cmd->key);
+        }
+    }
+
+    if(session.trace && ((session.steps++ % TRACE_EVERY) == 0))
+    {
+        fprintf(session.trace, "%.2f,%.3f,%.3f,%.3f,%u\n", now, session.plant.temp, session.plant.sensed,
+            session.plant.p.ambient_temp, session.plant.legs);
+    }
+}
+
+int session_run(const sim_config_t *cfg, plant_metrics_t *metrics, FILE *trace)
+{
+    sim_reset();
+    session.cfg = cfg;
+    session.trace = trace;
+    session.steps = 0;
+    plant_init(&session.plant, &cfg->plant, cfg->seed);
+
+    lm92_attach(&session.lm92, &session.plant);
+    ds3231_attach(&session.rtc, 2, BIT1);           // INT/SQW on P2.1
+    ledbar_attach(&session.ledbar);
+    sim_set_adc_source(lm19_sample, &session.plant);
+    sim_set_port_source(5, keypad_rows, NULL);
+    sim_uart_attach(console_tx, NULL);
+    sim_every((uint64_t)(PLANT_DT * SIM_PS_PER_S), plant_tick, NULL);
+    controller_attach_isrs();
+
+    if(trace)
+    {
+        fprintf(trace, "time,plant,sensed,ambient,legs\n");
+    }
+    int ret = sim_run(controller_main, cfg->duration);
+    *metrics = plant_metrics(&session.plant);
+    return ret;
+}
@@ -0,0 +1,48 @@
+/**
+* @file
+* @brief Glue between the simulator and the controller firmware image
+*
+* The firmware is compiled with -Dmain=controller_main; everything it keeps
+* in globals lives for one process, so run one session per process.
+*/
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "config.h"
+#include "plant.h"
+
+int controller_main(void);
+
+/**
+* attaches the controller's ISRs to their vectors
+*/
+void controller_attach_isrs(void);
+
+/**
+* holds a key down on the simulated keypad, or releases it with 0
+*/
+void controller_hold_key(char key);
+
+/**
+* sends whatever the firmware prints on its debug UART to console, or drops it with NULL
+*/
+void controller_set_console(FILE *console);
+
+/**
+* sets the ambient moving-average window before the firmware starts
+*/
+void controller_set_window(uint8_t window);
+
+/**
+* runs one closed-loop session of the controller against the plant
+*
+* @param trace: CSV of plant state every 0.1 s, or NULL
+*
+* @return: 0 on success, -1 if the firmware stalled
+*/
+int session_run(const sim_config_t *cfg, plant_metrics_t *metrics, FILE *trace);
+
+#endif
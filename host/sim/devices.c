@@ -0,0 +1,253 @@
+/**
+* @file
+* @brief I2C slaves on the controller's bus: LM92, DS3231 and the LED bar
+*/
+#include <string.h>
+
+#include "devices.h"
+#include "sim.h"
+
+//-- LM92 ----------------------------------------------------
+
+static void lm92_start(void *ctx, int read)
+{
+    lm92_t *dev = ctx;
+    dev->byte_idx = 0;
+    if(read)
+    {
+        dev->latched = (dev->pointer == 0) ? plant_lm92_register(dev->plant) : 0;
+    }
+}
+
+static void lm92_write(void *ctx, uint8_t byte)
+{
+    lm92_t *dev = ctx;
+    if(dev->byte_idx++ == 0)
+    {
+        dev->pointer = byte & 0x07;
+    }
+}
+
+static uint8_t lm92_read(void *ctx)
+{
+    lm92_t *dev = ctx;
+    return (dev->byte_idx++ & 1) ? (uint8_t)dev->latched : (uint8_t)(dev->latched >> 8);
+}
+
+void lm92_attach(lm92_t *dev, plant_t *plant)
+{
+    memset(dev, 0, sizeof(*dev));
+    dev->plant = plant;
+    sim_i2c_dev_t bus = { LM92_ADDR, dev, lm92_start, lm92_write, lm92_read, NULL };
+    sim_i2c_attach(&bus);
+}
+
+//-- DS3231 --------------------------------------------------
+
+static uint8_t bcd_increment(uint8_t *reg, uint8_t mask, uint8_t wrap)
+{
+    uint8_t value = (uint8_t)(((*reg & mask) >> 4) * 10 + (*reg & 0x0F)) + 1;
+    uint8_t carry = value >= wrap;
+    if(carry)
+    {
+        value = 0;
+    }
+    *reg = (uint8_t)((*reg & ~mask) | ((value / 10) << 4) | (value % 10));
+    return carry;
+}
+
+#define DS3231_CONTROL      0x0E
+#define DS3231_STATUS       0x0F
+#define DS3231_INTCN        0x04
+#define DS3231_A1IE         0x01
+#define DS3231_A2IE         0x02
+#define DS3231_A1F          0x01
+#define DS3231_A2F          0x02
+#define DS3231_RS           0x18
+
+/**
+* INT/SQW is pulled low while an enabled alarm is flagged (INTCN = 1) or
+* follows the square wave (INTCN = 0; only the 1 Hz rate is modelled)
+*/
+static void ds3231_update_pin(ds3231_t *dev)
+{
+    if(dev->int_port == 0)
+    {
+        return;
+    }
+    uint8_t control = dev->regs[DS3231_CONTROL], status = dev->regs[DS3231_STATUS];
+    if(!(control & DS3231_INTCN))
+    {
+        sim_drive_pin(dev->int_port, dev->int_bit, (control & DS3231_RS) ? 1 : dev->sqw);
+        return;
+    }
+    int asserted = (control & DS3231_INTCN) && (((control & DS3231_A1IE) && (status & DS3231_A1F)) ||
+                                                   ((control & DS3231_A2IE) && (status & DS3231_A2F)));
+    sim_drive_pin(dev->int_port, dev->int_bit, !asserted);
+}
+
+/**
+* alarm 1 matches on every field whose AxMn mask bit (bit 7) is clear
+*/
+static int ds3231_alarm1_match(const ds3231_t *dev)
+{
+    static const uint8_t value_mask[4] = { 0x7F, 0x7F, 0x3F, 0x3F };
+    int n;
+    for(n = 0; n < 4; ++n)
+    {
+        uint8_t alarm = dev->regs[0x07 + n];
+        uint8_t now = (n == 3) ? ((alarm & 0x40) ? dev->regs[0x03] : dev->regs[0x04]) : dev->regs[n];
+        if(!(alarm & 0x80) && ((alarm & value_mask[n]) != (now & value_mask[n])))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+* called every half second: the square wave rises, then falls as the seconds advance
+*/
+static void ds3231_tick(void *ctx)
+{
+    ds3231_t *dev = ctx;
+    dev->falling = !dev->falling;
+    if(dev->falling)
+    {
+        dev->sqw = 1;
+        ds3231_update_pin(dev);
+        return;
+    }
+    dev->sqw = 0;
+    if(bcd_increment(&dev->regs[0], 0x7F, 60) && bcd_increment(&dev->regs[1], 0x7F, 60))
+    {
+        bcd_increment(&dev->regs[2], 0x3F, 24);
+    }
+    if(ds3231_alarm1_match(dev))
+    {
+        dev->regs[DS3231_STATUS] |= DS3231_A1F;
+    }
+    ds3231_update_pin(dev);
+}
+
+static void ds3231_start(void *ctx, int read)
+{
+    ds3231_t *dev = ctx;
+    dev->first = !read;
+}
+
+static void ds3231_write(void *ctx, uint8_t byte)
+{
+    ds3231_t *dev = ctx;
+    if(dev->first)
+    {
+        dev->first = 0;
+        dev->pointer = (uint8_t)(byte % DS3231_REGS);
+        return;
+    }
+    if(dev->pointer == DS3231_STATUS)
+    {
+        // flags can only be cleared by the master
+        byte = (uint8_t)((dev->regs[DS3231_STATUS] & byte & 0x83) | (byte & 0x08));
+    }
+    dev->regs[dev->pointer] = byte;
+    ds3231_update_pin(dev);
+    if(dev->pointer == 0)
+    {
+        // writing seconds resets the countdown chain: next second is a full second away
+        sim_event_restart(dev->tick_event);
+        dev->falling = 0;
+    }
+    dev->pointer = (uint8_t)((dev->pointer + 1) % DS3231_REGS);
+}
+
+static uint8_t ds3231_read(void *ctx)
+{
+    ds3231_t *dev = ctx;
+    uint8_t byte = dev->regs[dev->pointer];
+    dev->pointer = (uint8_t)((dev->pointer + 1) % DS3231_REGS);
+    return byte;
+}
+
+void ds3231_attach(ds3231_t *dev, int int_port, uint8_t int_bit)
+{
+    memset(dev, 0, sizeof(*dev));
+    dev->regs[DS3231_CONTROL] = 0x1C;               // INTCN, RS2, RS1 set at power-up
+    dev->int_port = int_port;
+    dev->int_bit = int_bit;
+    ds3231_update_pin(dev);
+    dev->tick_event = sim_every(SIM_PS_PER_S / 2, ds3231_tick, dev);
+    sim_i2c_dev_t bus = { DS3231_ADDR, dev, ds3231_start, ds3231_write, ds3231_read, NULL };
+    sim_i2c_attach(&bus);
+}
+
+//-- LED bar -------------------------------------------------
+
+static void ledbar_start(void *ctx, int read)
+{
+    ledbar_t *dev = ctx;
+    dev->first = !read;
+    dev->wrote = 0;
+}
+
+static void ledbar_drop(ledbar_t *dev)
+{
+    if(dev->regs[LED_BAR_DROPPED] != 0xFF)
+    {
+        ++dev->regs[LED_BAR_DROPPED];
+    }
+}
+
+static void ledbar_write(void *ctx, uint8_t byte)
+{
+    ledbar_t *dev = ctx;
+    if(dev->first)
+    {
+        dev->first = 0;
+        dev->pointer = (byte < LED_BAR_REGS) ? byte : 0;
+        if(byte >= LED_BAR_REGS)
+        {
+            ledbar_drop(dev);
+        }
+        return;
+    }
+    if((dev->pointer == LED_BAR_APPLIED) || ((dev->pointer >= LED_BAR_DROPPED) && (dev->pointer <= LED_BAR_VERSION)))
+    {
+        ledbar_drop(dev);
+    }
+    else
+    {
+        dev->regs[dev->pointer] = byte;
+        dev->wrote = 1;
+        ++dev->writes;
+    }
+    dev->pointer = (uint8_t)((dev->pointer + 1) % LED_BAR_REGS);
+}
+
+static uint8_t ledbar_read(void *ctx)
+{
+    ledbar_t *dev = ctx;
+    uint8_t byte = dev->regs[dev->pointer];
+    dev->pointer = (uint8_t)((dev->pointer + 1) % LED_BAR_REGS);
+    return byte;
+}
+
+static void ledbar_stop(void *ctx)
+{
+    ledbar_t *dev = ctx;
+    if(dev->wrote)
+    {
+        ++dev->regs[LED_BAR_APPLIED];               // applied as a whole at STOP
+    }
+}
+
+void ledbar_attach(ledbar_t *dev)
+{
+    memset(dev, 0, sizeof(*dev));
+    dev->regs[0x02] = 64;                           // 1 s per frame
+    dev->regs[LED_BAR_VERSION] = 0x13;
+    dev->regs[0x07] = 1;                            // neutral animation: one frame
+    memset(&dev->regs[0x10], 7, 8);                 // full brightness
+    sim_i2c_dev_t bus = { LED_BAR_ADDR, dev, ledbar_start, ledbar_write, ledbar_read, ledbar_stop };
+    sim_i2c_attach(&bus);
+}
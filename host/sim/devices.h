@@ -0,0 +1,67 @@
+/**
+* @file
+* @brief I2C slaves on the controller's bus: LM92, DS3231 and the LED bar
+*/
+#ifndef DEVICES_H
+#define DEVICES_H
+
+#include <stdint.h>
+
+#include "plant.h"
+
+#define LM92_ADDR           0x48
+#define DS3231_ADDR         0x68
+#define LED_BAR_ADDR        0x0A
+
+#define DS3231_REGS         0x13
+#define LED_BAR_REGS        0x18
+#define LED_BAR_MODE        0x00
+#define LED_BAR_APPLIED     0x01
+#define LED_BAR_DROPPED     0x03
+#define LED_BAR_STATUS      0x04
+#define LED_BAR_VERSION     0x05
+
+typedef struct {
+    plant_t *plant;
+    uint8_t pointer;
+    uint16_t latched;                       // register captured at START
+    int byte_idx;
+} lm92_t;
+
+typedef struct {
+    uint8_t regs[DS3231_REGS];
+    uint8_t pointer;
+    int first;                              // next written byte is the register pointer
+    int tick_event;
+    int sqw;                                // 1 Hz square wave level, falls as seconds advance
+    int falling;                            // next half-second tick is the falling edge
+    int int_port;                           // INT/SQW wiring, 0 if not connected
+    uint8_t int_bit;
+} ds3231_t;
+
+typedef struct {
+    uint8_t regs[LED_BAR_REGS];
+    uint8_t pointer;
+    int first;                              // next written byte is the register pointer
+    int wrote;                              // this write changed a register
+    unsigned writes;                        // register bytes written
+} ledbar_t;
+
+/**
+* attaches an LM92 reading the plant's sensed temperature
+*/
+void lm92_attach(lm92_t *dev, plant_t *plant);
+
+/**
+* attaches a DS3231 counting from 00:00:00
+*
+* @param int_port, int_bit: MCU pin wired to the open-drain INT/SQW output
+*/
+void ds3231_attach(ds3231_t *dev, int int_port, uint8_t int_bit);
+
+/**
+* attaches an LED bar slave that records what it is told to show
+*/
+void ledbar_attach(ledbar_t *dev);
+
+#endif
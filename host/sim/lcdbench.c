@@ -0,0 +1,125 @@
+/**
+* @file
+* @brief Sustained throughput of the I2C LCD slave
+*
+* Streams updates at the LCD slave image back to back and reports the bytes
+* per second it takes, the share of bus time spent clock stretched and how
+* many times it redrew the display, then what the display shows once the
+* slave has caught up. The default workload is the byte
+* protocol's temperature updates (three digit bytes per write, a unit toggle
+* every 17th); "frame" sends the same readings as full 32-character frames.
+*
+* usage: lcdbench [seconds] [scl_hz] [frame]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+
+#define LCD_ADDR            0x0B
+#define FRAME_CMD           0xF0
+
+// LCD slave image, see i2c-lcd/app/main.c
+int lcd_main(void);
+void receive_data(void);
+void heartbeat_LED(void);
+uint8_t __real_lcd_refresh(void);
+extern char shadow[32];                                 // what the HD44780 was last sent
+
+static struct {
+    uint32_t hz;
+    double stop_at;                                     // no new writes after this
+    int frames;
+    uint8_t msg[33];
+    int len;
+    unsigned writes;
+    unsigned long bytes;
+    unsigned refreshes;
+} bench;
+
+/**
+* counts redraws on their way into the image's lcd_refresh()
+*/
+uint8_t __wrap_lcd_refresh(void)
+{
+    ++bench.refreshes;
+    return __real_lcd_refresh();
+}
+
+static void next_write(void *ctx, int acked)
+{
+    (void)ctx;
+    if(acked)
+    {
+        bench.bytes += bench.len;
+    }
+    ++bench.writes;
+    if(sim_seconds() >= bench.stop_at)
+    {
+        return;                                         // let the slave drain
+    }
+
+    unsigned t = 200 + (bench.writes % 100);            // 20.0 .. 29.9
+    char unit = ((bench.writes / 17) % 2) ? 'F' : 'C';
+    if(bench.frames)
+    {
+        char text[33];
+        snprintf(text, sizeof(text), "%-16s" "T=%u%u.%u\xDF%c     N=3", "fill left",
+                 t / 100, (t / 10) % 10, t % 10, unit);
+        bench.msg[0] = FRAME_CMD;
+        memcpy(&bench.msg[1], text, 32);
+        bench.len = 33;
+    }
+    else if(bench.writes % 17 == 16)
+    {
+        bench.msg[0] = 'C';
+        bench.len = 1;
+    }
+    else
+    {
+        bench.msg[0] = (uint8_t)('0' + t / 100);
+        bench.msg[1] = (uint8_t)('0' + (t / 10) % 10);
+        bench.msg[2] = (uint8_t)('0' + t % 10);
+        bench.len = 3;
+    }
+    sim_i2c_slave_write(LCD_ADDR, bench.msg, bench.len, bench.hz, next_write, NULL);
+}
+
+static void first_write(void *ctx)
+{
+    static int started;
+    if(!started)
+    {
+        started = 1;
+        bench.writes = (unsigned)-1;                    // next_write counts this one in
+        next_write(ctx, 0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 10.0;
+    bench.hz = (argc > 2) ? (uint32_t)atol(argv[2]) : 100000;
+    bench.frames = (argc > 3) && (strcmp(argv[3], "frame") == 0);
+    bench.stop_at = 0.1 + seconds;
+
+    sim_reset();
+    sim_attach_isr(SIM_VEC_EUSCI_B0, receive_data);
+    sim_attach_isr(SIM_VEC_TIMER0_B0, heartbeat_LED);
+    sim_every(SIM_PS_PER_S / 10, first_write, NULL);   // after init_lcd() has run
+
+    if(sim_run(lcd_main, bench.stop_at + 0.5) != 0)
+    {
+        fprintf(stderr, "lcdbench: slave image stopped\n");
+        return 2;
+    }
+
+    double busy = seconds;
+    printf("bytes_per_s: %.0f\n", bench.bytes / busy);
+    printf("writes_per_s: %.0f\n", bench.writes / busy);
+    printf("stretched: %.1f %%\n", 100.0 * ((double)sim_i2c_stretch_ps / SIM_PS_PER_S) / busy);
+    printf("refreshes_per_s: %.1f\n", bench.refreshes / busy);
+    printf("display: |%.16s|%.16s|\n", shadow, shadow + 16);
+    return 0;
+}
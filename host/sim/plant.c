@@ -0,0 +1,162 @@
+/**
+* @file
+* @brief First-order thermal model of the Peltier plant and its sensors
+*/
+#include <math.h>
+
+#include "plant.h"
+
+#define LM92_LSB            0.0625          // degC per count
+#define LM19_SCALE          0.0114          // degC per ADC count, as in avg_temp()
+
+void plant_defaults(plant_params_t *p)
+{
+    p->thermal_mass = 120.0;
+    p->peltier_heat = 6.0;
+    p->peltier_cool = 4.0;
+    p->peltier_power = 12.0;
+    p->ambient_coupling = 0.15;
+    p->ambient_temp = 22.0;
+    p->initial_temp = 30.0;
+    p->lm92_lag = 4.0;
+    p->lm92_noise = 0.05;
+    p->lm19_noise = 0.2;
+    p->settle_band = 1.0;
+}
+
+static double uniform(plant_t *plant)
+{
+    // xorshift64*
+    plant->rng ^= plant->rng >> 12;
+    plant->rng ^= plant->rng << 25;
+    plant->rng ^= plant->rng >> 27;
+    return (double)((plant->rng * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double gaussian(plant_t *plant)
+{
+    double u1 = uniform(plant), u2 = uniform(plant);
+    if(u1 < 1e-300)
+    {
+        u1 = 1e-300;
+    }
+    return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+void plant_init(plant_t *plant, const plant_params_t *p, uint64_t seed)
+{
+    plant->p = *p;
+    plant->temp = p->initial_temp;
+    plant->sensed = p->initial_temp;
+    plant->now = 0;
+    plant->start = 0;
+    plant->rng = seed ? seed : 0x9E3779B97F4A7C15ULL;
+    plant->legs = 0;
+    plant->initial_sign = (p->initial_temp > p->ambient_temp) ? 1 : -1;
+    plant->last_outside = 0;
+    plant->m = (plant_metrics_t){ 0 };
+}
+
+void plant_start_metrics(plant_t *plant, double now)
+{
+    plant->start = now;
+    plant->last_outside = now;
+    plant->initial_sign = (plant->temp > plant->p.ambient_temp) ? 1 : -1;
+    plant->m = (plant_metrics_t){ 0 };
+}
+
+void plant_step(plant_t *plant, double dt, uint8_t legs)
+{
+    const plant_params_t *p = &plant->p;
+    double q = p->ambient_coupling * (p->ambient_temp - plant->temp);
+
+    legs &= PLANT_LEG_HEAT | PLANT_LEG_COOL;
+    if(legs == (PLANT_LEG_HEAT | PLANT_LEG_COOL))
+    {
+        // shoot-through: the bridge shorts, nothing is pumped
+        plant->m.shoot_through += dt;
+    }
+    else if(legs == PLANT_LEG_HEAT)
+    {
+        q += p->peltier_heat;
+    }
+    else if(legs == PLANT_LEG_COOL)
+    {
+        q -= p->peltier_cool;
+    }
+    if(legs != 0)
+    {
+        plant->m.energy += p->peltier_power * dt;
+    }
+    if(legs != plant->legs)
+    {
+        ++plant->m.switches;
+        plant->legs = legs;
+    }
+
+    plant->temp += q * dt / p->thermal_mass;
+    if(p->lm92_lag > 0)
+    {
+        plant->sensed += (plant->temp - plant->sensed) * (1.0 - exp(-dt / p->lm92_lag));
+    }
+    else
+    {
+        plant->sensed = plant->temp;
+    }
+    plant->now += dt;
+
+    double error = plant->temp - p->ambient_temp;
+    if(fabs(error) > p->settle_band)
+    {
+        plant->last_outside = plant->now;
+    }
+    double past = -error * plant->initial_sign;
+    if(past > plant->m.overshoot)
+    {
+        plant->m.overshoot = past;
+    }
+}
+
+uint16_t plant_lm92_register(plant_t *plant)
+{
+    double reading = plant->sensed + plant->p.lm92_noise * gaussian(plant);
+    long counts = lround(reading / LM92_LSB);
+    if(counts > 4095)
+    {
+        counts = 4095;
+    }
+    else if(counts < -4096)
+    {
+        counts = -4096;
+    }
+    return (uint16_t)((uint16_t)counts << 3);
+}
+
+uint16_t plant_lm19_counts(plant_t *plant)
+{
+    double reading = plant->p.ambient_temp + plant->p.lm19_noise * gaussian(plant);
+    long counts = lround(reading / LM19_SCALE);
+    if(counts > 4095)
+    {
+        counts = 4095;
+    }
+    else if(counts < 0)
+    {
+        counts = 0;
+    }
+    return (uint16_t)counts;
+}
+
+plant_metrics_t plant_metrics(const plant_t *plant)
+{
+    plant_metrics_t m = plant->m;
+    if(fabs(plant->temp - plant->p.ambient_temp) > plant->p.settle_band)
+    {
+        m.settling_time = -1;
+    }
+    else
+    {
+        m.settling_time = plant->last_outside - plant->start;
+    }
+    return m;
+}
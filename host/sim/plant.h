@@ -0,0 +1,94 @@
+/**
+* @file
+* @brief First-order thermal model of the Peltier plant and its sensors
+*
+* The plant is a single thermal mass coupled to ambient and pumped by the
+* Peltier device:  C dT/dt = Q_peltier + G (T_ambient - T).
+* The LM92 sees the plant through a first-order lag plus noise; the LM19
+* sees ambient plus noise.
+*/
+#ifndef PLANT_H
+#define PLANT_H
+
+#include <stdint.h>
+
+#define PLANT_LEG_HEAT      0x01            // P6.0
+#define PLANT_LEG_COOL      0x02            // P6.1
+
+/**
+* physical and sensor parameters, all SI except temperatures in Celsius
+*/
+typedef struct {
+    double thermal_mass;                    // J/K
+    double peltier_heat;                    // W pumped in while heating
+    double peltier_cool;                    // W pumped out while cooling
+    double peltier_power;                   // W drawn while either leg is on
+    double ambient_coupling;                // W/K
+    double ambient_temp;
+    double initial_temp;
+    double lm92_lag;                        // s, sensor time constant
+    double lm92_noise;                      // degC rms
+    double lm19_noise;                      // degC rms
+    double settle_band;                     // degC, +/- around ambient
+} plant_params_t;
+
+/**
+* closed-loop figures of merit for one session
+*/
+typedef struct {
+    double settling_time;                   // s after start, < 0 if never settled
+    double overshoot;                       // degC past ambient on the far side
+    double energy;                          // J drawn by the Peltier
+    double shoot_through;                   // s with both legs driven
+    unsigned switches;                      // actuator leg changes
+} plant_metrics_t;
+
+typedef struct {
+    plant_params_t p;
+    double temp;                            // true plant temperature
+    double sensed;                          // LM92 die temperature
+    double now;
+    double start;                           // metrics are taken from here on
+    uint64_t rng;
+    uint8_t legs;
+    int initial_sign;
+    double last_outside;
+    plant_metrics_t m;
+} plant_t;
+
+/**
+* loads the defaults, used for any key a config file leaves out
+*/
+void plant_defaults(plant_params_t *p);
+
+/**
+* resets the plant to its initial temperature
+*/
+void plant_init(plant_t *plant, const plant_params_t *p, uint64_t seed);
+
+/**
+* starts the metrics window, e.g. when a mode key is pressed
+*/
+void plant_start_metrics(plant_t *plant, double now);
+
+/**
+* integrates dt seconds with the given Peltier legs driven
+*/
+void plant_step(plant_t *plant, double dt, uint8_t legs);
+
+/**
+* LM92 temperature register: 13-bit two's complement in bits 15..3, 0.0625 degC/LSB
+*/
+uint16_t plant_lm92_register(plant_t *plant);
+
+/**
+* LM19 reading as 12-bit ADC counts, scaled the same way the controller decodes them
+*/
+uint16_t plant_lm19_counts(plant_t *plant);
+
+/**
+* finishes the metrics at the current time
+*/
+plant_metrics_t plant_metrics(const plant_t *plant);
+
+#endif
@@ -0,0 +1,68 @@
+/**
+* @file
+* @brief Runs one closed-loop controller session against the plant model
+*
+* usage: plantsim [config] [trace.csv] [console.txt]
+*/
+#include <stdio.h>
+
+#include "config.h"
+#include "controller.h"
+
+int main(int argc, char **argv)
+{
+    sim_config_t cfg;
+    config_defaults(&cfg);
+    if((argc > 1) && (config_load(&cfg, argv[1]) != 0))
+    {
+        return 1;
+    }
+
+    FILE *trace = NULL;
+    if(argc > 2)
+    {
+        trace = fopen(argv[2], "w");
+        if(trace == NULL)
+        {
+            perror(argv[2]);
+            return 1;
+        }
+    }
+
+    FILE *console = NULL;
+    if(argc > 3)
+    {
+        console = fopen(argv[3], "w");
+        if(console == NULL)
+        {
+            perror(argv[3]);
+            return 1;
+        }
+        controller_set_console(console);
+    }
+
+    plant_metrics_t m;
+    int ret = session_run(&cfg, &m, trace);
+    if(trace)
+    {
+        fclose(trace);
+    }
+    if(console)
+    {
+        fclose(console);
+    }
+
+    if(m.settling_time < 0)
+    {
+        printf("settling_time: never\n");
+    }
+    else
+    {
+        printf("settling_time: %.1f s\n", m.settling_time);
+    }
+    printf("overshoot: %.2f C\n", m.overshoot);
+    printf("energy: %.0f J\n", m.energy);
+    printf("switches: %u\n", m.switches);
+    printf("shoot_through: %.2f s\n", m.shoot_through);
+    return ret == 0 ? 0 : 2;
+}
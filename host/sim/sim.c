@@ -0,0 +1,1123 @@
+/**
+* @file
+* @brief Host-side MSP430FR2355 peripheral model
+*
+* Event driven: time jumps straight to the next timer compare, I2C bit
+* boundary, UART byte, ADC completion or periodic callback instead of
+* stepping cycles.
+*/
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "msp430fr2355.h"
+#include "sim.h"
+
+#define MAX_EVENTS          16
+#define MAX_I2C_DEVS        8
+#define MAX_DISPATCH        100000          // ISRs at one instant before we call it a stall
+#define NEVER               UINT64_MAX
+#define CSCTL2_RESET        0x101F          // FLLD /2, FLLN 31: the nominal 1 MHz DCOCLKDIV
+
+uint64_t sim_now;
+uint32_t sim_mclk_hz = 1000000, sim_smclk_hz = 1000000, sim_aclk_hz = 32768;
+
+// registers
+volatile uint16_t WDTCTL, PM5CTL0, SYSCFG0;
+volatile uint16_t CSCTL0, CSCTL1, CSCTL2, CSCTL3, CSCTL4, CSCTL5, CSCTL6, CSCTL7, CSCTL8, FRCTL0;
+sim_port_t sim_port[7];
+sim_timer_t sim_tb[4];
+volatile uint16_t sim_ucb0ctlw0, UCB0CTLW1, UCB0BRW, sim_ucb0statw, UCB0TBCNT, UCB0I2COA0, UCB0I2CSA, UCB0IE, UCB0IFG;
+volatile uint16_t UCB0RXBUF, UCB0TXBUF;
+volatile uint16_t sim_uca1ifg, UCA1CTLW0, UCA1BRW, UCA1MCTLW, UCA1STATW, UCA1IE;
+volatile uint16_t sim_uca1rxbuf, sim_uca1txbuf;
+volatile uint16_t ADCCTL0, ADCCTL1, ADCCTL2, ADCMCTL0, ADCMEM0, ADCIE, ADCIFG;
+
+static uint16_t sr;
+static uint16_t *isr_saved_sr;             // SR restored on exit of the running ISR
+static sim_isr_t isr_table[SIM_VEC_COUNT];
+static uint64_t end_ps;
+static jmp_buf run_jmp;
+static int stalled;
+static int fram_warned;
+static uint64_t dispatch_at;
+static unsigned dispatch_count;
+
+static struct {
+    uint64_t next;
+    uint16_t mode;
+} timer_state[4];
+
+static struct {
+    uint64_t next, period;
+    void (*fn)(void *ctx);
+    void *ctx;
+} events[MAX_EVENTS];
+static int event_count;
+
+enum { I2C_IDLE, I2C_ADDR, I2C_TX_WAIT, I2C_TX_SHIFT, I2C_RX_SHIFT };
+static struct {
+    int state;
+    uint64_t next;
+    const sim_i2c_dev_t *dev;
+    int tx, autostop, txifg_taken;
+    uint16_t count;
+    uint8_t byte;
+} i2c;
+static sim_i2c_dev_t i2c_devs[MAX_I2C_DEVS];
+static int i2c_dev_count;
+
+enum { SLAVE_IDLE, SLAVE_ADDR, SLAVE_SHIFT, SLAVE_STRETCH, SLAVE_STOP };
+static struct {
+    int state, acked;
+    uint64_t next, bit_ps, stretch_from;
+    uint8_t addr;
+    const uint8_t *bytes;
+    int len, idx;
+    void (*done)(void *ctx, int acked);
+    void *ctx;
+} slave;
+uint64_t sim_i2c_stretch_ps;
+
+static struct {
+    int loaded;                             // TXBUF written, not yet moved to the shift register
+    uint64_t next;                          // current byte done shifting
+    uint8_t byte;
+    void (*tx)(void *ctx, uint8_t byte);
+    void *ctx;
+} uart;
+
+static struct {
+    int busy;
+    uint64_t done;
+    uint16_t (*sample)(void *ctx, int channel);
+    void *ctx;
+} adc;
+
+static struct {
+    uint8_t (*read)(void *ctx, int port);
+    void *ctx;
+    uint8_t ext, ext_mask;
+} port_src[7];
+
+static void step(uint64_t limit);
+static void adc_start(uint64_t at);
+
+//-- helpers ---------------------------------------------
+
+static uint64_t min64(uint64_t a, uint64_t b)
+{
+    return a < b ? a : b;
+}
+
+static uint64_t mclk_ps(void)
+{
+    return SIM_PS_PER_S / sim_mclk_hz;
+}
+
+double sim_seconds(void)
+{
+    return (double)sim_now / (double)SIM_PS_PER_S;
+}
+
+//-- clock system ------------------------------------------
+
+/**
+* MCLK and SMCLK from the clock registers
+*
+* Until the firmware programs the FLL the DCO is taken as an even 1 MHz. The
+* FLL is assumed locked the moment it is set up.
+*/
+static void cs_sync(void)
+{
+    uint32_t dco = 1000000;
+    if(CSCTL2 != CSCTL2_RESET)
+    {
+        dco = (((CSCTL2 & FLLN) + 1u) * sim_aclk_hz) >> ((CSCTL2 & FLLD) >> 12);
+    }
+    uint32_t mclk = ((CSCTL4 & SELMS) == SELMS__DCOCLKDIV) ? dco : sim_aclk_hz;
+    sim_mclk_hz = mclk >> (CSCTL5 & DIVM);
+    sim_smclk_hz = sim_mclk_hz >> ((CSCTL5 & DIVS) >> 4);
+
+    unsigned waits = (FRCTL0 & NWAITS) >> 4;
+    if((sim_mclk_hz > 8000000u * (waits + 1)) && !fram_warned)
+    {
+        fprintf(stderr, "sim: MCLK %u Hz with %u FRAM wait states reads garbage on the real part\n",
+                (unsigned)sim_mclk_hz, waits);
+        fram_warned = 1;
+    }
+}
+
+//-- Timer_B ---------------------------------------------
+
+static int timer_ccrs(int i)
+{
+    return i == 3 ? 7 : 3;
+}
+
+static uint64_t timer_period_ps(int i)
+{
+    uint16_t ctl = sim_tb[i].ctl;
+    uint32_t hz = ((ctl & TBSSEL) == TBSSEL__ACLK) ? sim_aclk_hz : sim_smclk_hz;
+    uint32_t div = (1u << ((ctl & ID) >> 6)) * ((sim_tb[i].ex0 & TBIDEX) + 1u);
+    return (SIM_PS_PER_S * div) / hz;
+}
+
+static int timer_running(int i)
+{
+    uint16_t mode = sim_tb[i].ctl & MC;
+    return (mode == MC__CONTINUOUS) || ((mode == MC__UP) && (sim_tb[i].ccr[0] != 0));
+}
+
+/**
+* ticks until the counter next reaches value (1 = the very next tick)
+*/
+static uint64_t timer_distance(int i, uint32_t value)
+{
+    sim_timer_t *t = &sim_tb[i];
+    if((t->ctl & MC) == MC__CONTINUOUS)
+    {
+        uint32_t d = (value - t->r) & 0xFFFF;
+        return d ? d : 0x10000;
+    }
+    uint32_t top = t->ccr[0];
+    if(value > top)
+    {
+        return NEVER;
+    }
+    if(t->r >= top)
+    {
+        return 1u + value;
+    }
+    if(value > t->r)
+    {
+        return value - t->r;
+    }
+    return (top - t->r) + 1u + value;
+}
+
+static void timer_sync(int i)
+{
+    sim_timer_t *t = &sim_tb[i];
+    if(t->ctl & TBCLR)
+    {
+        t->ctl &= ~TBCLR;
+        t->r = 0;
+        timer_state[i].next = sim_now + timer_period_ps(i);
+    }
+    uint16_t mode = t->ctl & MC;
+    if(mode != timer_state[i].mode)
+    {
+        if(timer_state[i].mode == MC__STOP)
+        {
+            timer_state[i].next = sim_now + timer_period_ps(i);
+        }
+        timer_state[i].mode = mode;
+    }
+}
+
+/**
+* TB1.1 triggers the ADC (ADCSHS = 1) and its rising edge starts a conversion
+*
+* Only reset/set output in up mode is modelled, which rises at CCR0.
+*/
+static int timer_triggers_adc(int i)
+{
+    return (i == 1) && ((ADCCTL1 & ADCSHS) == ADCSHS_1) && ((ADCCTL0 & (ADCENC | ADCON)) == (ADCENC | ADCON)) &&
+           ((sim_tb[1].cctl[1] & OUTMOD) == OUTMOD_7) && ((sim_tb[1].ctl & MC) == MC__UP);
+}
+
+static uint64_t timer_next_event(int i)
+{
+    if(!timer_running(i))
+    {
+        return NEVER;
+    }
+    sim_timer_t *t = &sim_tb[i];
+    uint64_t ticks = NEVER;
+    int n;
+    for(n = 0; n < timer_ccrs(i); ++n)
+    {
+        if(t->cctl[n] & CCIE)
+        {
+            ticks = min64(ticks, timer_distance(i, t->ccr[n]));
+        }
+    }
+    if(t->ctl & TBIE)
+    {
+        ticks = min64(ticks, timer_distance(i, 0));
+    }
+    if(timer_triggers_adc(i))
+    {
+        ticks = min64(ticks, timer_distance(i, t->ccr[0]));
+    }
+    if(ticks == NEVER)
+    {
+        return NEVER;
+    }
+    return timer_state[i].next + (ticks - 1) * timer_period_ps(i);
+}
+
+static void timer_advance(int i, uint64_t to)
+{
+    if(!timer_running(i) || (timer_state[i].next > to))
+    {
+        return;
+    }
+    sim_timer_t *t = &sim_tb[i];
+    uint64_t period = timer_period_ps(i);
+    uint64_t ticks = (to - timer_state[i].next) / period + 1;
+    int n;
+    for(n = 0; n < timer_ccrs(i); ++n)
+    {
+        if(!(t->cctl[n] & CAP) && (timer_distance(i, t->ccr[n]) <= ticks))
+        {
+            t->cctl[n] |= CCIFG;
+        }
+    }
+    if(timer_distance(i, 0) <= ticks)
+    {
+        t->ctl |= TBIFG;
+    }
+    if(timer_triggers_adc(i) && (timer_distance(i, t->ccr[0]) <= ticks))
+    {
+        adc_start(timer_state[i].next + (timer_distance(i, t->ccr[0]) - 1) * period);
+    }
+    if((t->ctl & MC) == MC__CONTINUOUS)
+    {
+        t->r = (uint16_t)(t->r + ticks);
+    }
+    else if(t->r >= t->ccr[0])
+    {
+        t->r = (uint16_t)((ticks - 1) % (t->ccr[0] + 1u));
+    }
+    else
+    {
+        t->r = (uint16_t)((t->r + ticks) % (t->ccr[0] + 1u));
+    }
+    timer_state[i].next += ticks * period;
+}
+
+uint16_t sim_tb_iv(int i)
+{
+    sim_timer_t *t = &sim_tb[i];
+    int n;
+    for(n = 1; n < timer_ccrs(i); ++n)
+    {
+        if((t->cctl[n] & (CCIE | CCIFG)) == (CCIE | CCIFG))
+        {
+            t->cctl[n] &= ~CCIFG;
+            return (uint16_t)(2 * n);
+        }
+    }
+    if((t->ctl & (TBIE | TBIFG)) == (TBIE | TBIFG))
+    {
+        t->ctl &= ~TBIFG;
+        return TBIV__TBIFG;
+    }
+    return TBIV_NONE;
+}
+
+//-- eUSCI_B0 I2C master ---------------------------------
+
+static uint64_t i2c_bit_ps(void)
+{
+    uint32_t div = UCB0BRW ? UCB0BRW : 1;
+    return (SIM_PS_PER_S * div) / sim_smclk_hz;
+}
+
+static void i2c_start(void)
+{
+    uint8_t addr = UCB0I2CSA & 0x7F;
+    int d;
+
+    i2c.dev = NULL;
+    for(d = 0; d < i2c_dev_count; ++d)
+    {
+        if(i2c_devs[d].addr == addr)
+        {
+            i2c.dev = &i2c_devs[d];
+        }
+    }
+    i2c.tx = (sim_ucb0ctlw0 & UCTR) != 0;
+    i2c.count = UCB0TBCNT;
+    i2c.autostop = (UCB0CTLW1 & 0x000C) == UCASTP_2;
+    i2c.txifg_taken = 0;
+    i2c.state = I2C_ADDR;
+    i2c.next = sim_now + 10 * i2c_bit_ps();       // START + 7-bit address + R/W + ACK
+    sim_ucb0statw |= UCBBUSY;
+}
+
+static void i2c_stop(void)
+{
+    if(i2c.dev && i2c.dev->stop)
+    {
+        i2c.dev->stop(i2c.dev->ctx);
+    }
+    sim_ucb0ctlw0 &= ~UCTXSTP;
+    UCB0IFG |= UCSTPIFG;
+    sim_ucb0statw &= ~UCBBUSY;
+    i2c.state = I2C_IDLE;
+    i2c.next = NEVER;
+}
+
+static void i2c_sync(void)
+{
+    if(sim_ucb0ctlw0 & UCSWRST)
+    {
+        i2c.state = I2C_IDLE;
+        i2c.next = NEVER;
+        sim_ucb0statw &= ~UCBBUSY;
+        return;
+    }
+    if((i2c.state == I2C_IDLE) && (sim_ucb0ctlw0 & UCMST) && (sim_ucb0ctlw0 & UCTXSTT))
+    {
+        i2c_start();
+    }
+}
+
+static void i2c_after_byte(void)
+{
+    if((i2c.autostop && (i2c.count == 0)) || (sim_ucb0ctlw0 & UCTXSTP))
+    {
+        if(i2c.autostop && (i2c.count == 0))
+        {
+            UCB0IFG |= UCBCNTIFG;
+        }
+        i2c_stop();
+        return;
+    }
+    if(sim_ucb0ctlw0 & UCTXSTT)
+    {
+        i2c_start();                                // repeated START
+        return;
+    }
+    if(i2c.tx)
+    {
+        UCB0IFG |= UCTXIFG0;
+        i2c.state = I2C_TX_WAIT;
+        i2c.next = NEVER;
+    }
+    else
+    {
+        i2c.next = sim_now + 9 * i2c_bit_ps();
+    }
+}
+
+static void i2c_event(void)
+{
+    switch(i2c.state)
+    {
+        case I2C_ADDR:
+            sim_ucb0ctlw0 &= ~UCTXSTT;
+            if(i2c.dev == NULL)
+            {
+                UCB0IFG |= UCNACKIFG;
+                sim_ucb0statw &= ~UCBBUSY;
+                i2c.state = I2C_IDLE;
+                i2c.next = NEVER;
+                break;
+            }
+            if(i2c.dev->start)
+            {
+                i2c.dev->start(i2c.dev->ctx, !i2c.tx);
+            }
+            if(i2c.tx)
+            {
+                UCB0IFG |= UCTXIFG0;
+                i2c.state = I2C_TX_WAIT;
+                i2c.next = NEVER;
+            }
+            else
+            {
+                i2c.state = I2C_RX_SHIFT;
+                i2c.next = sim_now + 9 * i2c_bit_ps();
+            }
+            break;
+        case I2C_TX_SHIFT:
+            if(i2c.dev->write)
+            {
+                i2c.dev->write(i2c.dev->ctx, i2c.byte);
+            }
+            --i2c.count;
+            i2c_after_byte();
+            break;
+        case I2C_RX_SHIFT:
+            UCB0RXBUF = i2c.dev->read ? i2c.dev->read(i2c.dev->ctx) : 0xFF;
+            UCB0IFG |= UCRXIFG0;
+            --i2c.count;
+            i2c_after_byte();
+            break;
+        default:
+            i2c.next = NEVER;
+            break;
+    }
+}
+
+/**
+* the byte loaded into TXBUF while servicing UCTXIFG0 starts shifting out
+*/
+static void i2c_after_isr(void)
+{
+    if((i2c.state == I2C_TX_WAIT) && i2c.txifg_taken)
+    {
+        i2c.txifg_taken = 0;
+        i2c.byte = (uint8_t)UCB0TXBUF;
+        i2c.state = I2C_TX_SHIFT;
+        i2c.next = sim_now + 9 * i2c_bit_ps();
+    }
+}
+
+volatile uint16_t *sim_ucb0ctlw0_access(void)
+{
+    i2c_sync();
+    if((i2c.state != I2C_IDLE) && (sim_ucb0ctlw0 & UCTXSTP))
+    {
+        step(sim_now + mclk_ps());                  // polling for STOP costs time
+    }
+    return &sim_ucb0ctlw0;
+}
+
+volatile uint16_t *sim_ucb0statw_access(void)
+{
+    i2c_sync();
+    if(sim_ucb0statw & UCBBUSY)
+    {
+        step(sim_now + mclk_ps());                  // polling for bus idle costs time
+    }
+    return &sim_ucb0statw;
+}
+
+uint16_t sim_ucb0iv(void)
+{
+    static const struct {
+        uint16_t flag, iv;
+    } order[] = {
+        { UCALIFG, USCI_I2C_UCALIFG },   { UCNACKIFG, USCI_I2C_UCNACKIFG }, { UCSTTIFG, USCI_I2C_UCSTTIFG },
+        { UCSTPIFG, USCI_I2C_UCSTPIFG }, { UCRXIFG0, USCI_I2C_UCRXIFG0 },   { UCTXIFG0, USCI_I2C_UCTXIFG0 },
+        { UCBCNTIFG, USCI_I2C_UCBCNTIFG },
+    };
+    unsigned n;
+    for(n = 0; n < sizeof(order) / sizeof(order[0]); ++n)
+    {
+        if(UCB0IE & UCB0IFG & order[n].flag)
+        {
+            UCB0IFG &= ~order[n].flag;
+            if(order[n].flag == UCTXIFG0)
+            {
+                i2c.txifg_taken = 1;
+            }
+            return order[n].iv;
+        }
+    }
+    return USCI_NONE;
+}
+
+//-- eUSCI_B0 I2C slave ----------------------------------
+
+static void slave_deliver(void)
+{
+    UCB0RXBUF = slave.bytes[slave.idx++];
+    UCB0IFG |= UCRXIFG0;
+    if(slave.idx == slave.len)
+    {
+        slave.state = SLAVE_STOP;
+        slave.next = sim_now + slave.bit_ps;
+    }
+    else
+    {
+        slave.state = SLAVE_SHIFT;
+        slave.next = sim_now + 9 * slave.bit_ps;
+    }
+}
+
+static void slave_sync(void)
+{
+    // a stretched byte goes through as soon as RXBUF has been taken
+    if((slave.state == SLAVE_STRETCH) && !(UCB0IFG & UCRXIFG0))
+    {
+        sim_i2c_stretch_ps += sim_now - slave.stretch_from;
+        slave_deliver();
+    }
+}
+
+static void slave_event(void)
+{
+    switch(slave.state)
+    {
+        case SLAVE_ADDR:
+            slave.acked = !(sim_ucb0ctlw0 & (UCSWRST | UCMST)) && (UCB0I2COA0 & UCOAEN) &&
+                          ((UCB0I2COA0 & 0x7F) == slave.addr);
+            if(slave.acked && slave.len)
+            {
+                UCB0IFG |= UCSTTIFG;
+                slave.state = SLAVE_SHIFT;
+                slave.next = sim_now + 9 * slave.bit_ps;
+            }
+            else
+            {
+                slave.state = SLAVE_STOP;
+                slave.next = sim_now + slave.bit_ps;
+            }
+            break;
+        case SLAVE_SHIFT:
+            if(UCB0IFG & UCRXIFG0)
+            {
+                slave.state = SLAVE_STRETCH;        // RXBUF still full: SCL held low
+                slave.stretch_from = sim_now;
+                slave.next = NEVER;
+            }
+            else
+            {
+                slave_deliver();
+            }
+            break;
+        case SLAVE_STOP:
+            if(slave.acked)
+            {
+                UCB0IFG |= UCSTPIFG;
+            }
+            slave.state = SLAVE_IDLE;
+            slave.next = NEVER;
+            if(slave.done)
+            {
+                slave.done(slave.ctx, slave.acked);
+            }
+            break;
+        default:
+            slave.next = NEVER;
+            break;
+    }
+}
+
+int sim_i2c_slave_write(uint8_t addr, const uint8_t *bytes, int len, uint32_t hz,
+                        void (*done)(void *ctx, int acked), void *ctx)
+{
+    if(slave.state != SLAVE_IDLE)
+    {
+        return -1;
+    }
+    slave.addr = addr;
+    slave.bytes = bytes;
+    slave.len = len;
+    slave.idx = 0;
+    slave.done = done;
+    slave.ctx = ctx;
+    slave.bit_ps = SIM_PS_PER_S / hz;
+    slave.state = SLAVE_ADDR;
+    slave.next = sim_now + 10 * slave.bit_ps;     // START + 7-bit address + W + ACK
+    return 0;
+}
+
+//-- eUSCI_A1 UART ------------------------------------------
+
+static uint64_t uart_bit_ps(void)
+{
+    uint32_t div = UCA1BRW ? UCA1BRW : 1;
+    if(UCA1MCTLW & UCOS16)
+    {
+        div = 16 * div + ((UCA1MCTLW & UCBRF) >> 4);
+    }
+    return (SIM_PS_PER_S * div) / sim_smclk_hz;
+}
+
+/**
+* a byte written to TXBUF moves to the shift register as soon as it is free
+*/
+static void uart_sync(void)
+{
+    if(UCA1CTLW0 & UCSWRST)
+    {
+        uart.loaded = 0;
+        uart.next = NEVER;
+        sim_uca1ifg = UCTXIFG;
+        UCA1STATW = 0;
+        return;
+    }
+    if(uart.loaded && (uart.next == NEVER))
+    {
+        uart.loaded = 0;
+        uart.byte = (uint8_t)sim_uca1txbuf;
+        uart.next = sim_now + 10 * uart_bit_ps();   // start, 8 data, stop
+        sim_uca1ifg |= UCTXIFG;
+        UCA1STATW |= BIT0;                          // UCBUSY
+    }
+}
+
+static void uart_event(void)
+{
+    uart.next = NEVER;
+    UCA1STATW &= ~BIT0;
+    if(uart.tx)
+    {
+        uart.tx(uart.ctx, uart.byte);
+    }
+    uart_sync();
+}
+
+volatile uint16_t *sim_uca1ifg_access(void)
+{
+    uart_sync();
+    if(!(sim_uca1ifg & UCTXIFG) && (uart.next != NEVER))
+    {
+        step(sim_now + mclk_ps());                  // polling for room costs time
+    }
+    return &sim_uca1ifg;
+}
+
+volatile uint16_t *sim_uca1txbuf_access(void)
+{
+    sim_uca1ifg &= ~UCTXIFG;
+    uart.loaded = 1;
+    return &sim_uca1txbuf;
+}
+
+uint16_t sim_uca1rxbuf_read(void)
+{
+    sim_uca1ifg &= ~UCRXIFG;
+    return sim_uca1rxbuf;
+}
+
+uint16_t sim_uca1iv(void)
+{
+    uart_sync();
+    if(UCA1IE & sim_uca1ifg & UCRXIFG)
+    {
+        sim_uca1ifg &= ~UCRXIFG;
+        return USCI_UART_UCRXIFG;
+    }
+    if(UCA1IE & sim_uca1ifg & UCTXIFG)
+    {
+        sim_uca1ifg &= ~UCTXIFG;
+        return USCI_UART_UCTXIFG;
+    }
+    return USCI_NONE;
+}
+
+void sim_uart_attach(void (*tx)(void *ctx, uint8_t byte), void *ctx)
+{
+    uart.tx = tx;
+    uart.ctx = ctx;
+}
+
+void sim_uart_rx(uint8_t byte)
+{
+    if(!(UCA1CTLW0 & UCSWRST))
+    {
+        sim_uca1rxbuf = byte;
+        sim_uca1ifg |= UCRXIFG;
+    }
+}
+
+//-- ADC ---------------------------------------------------
+
+/**
+* a trigger arriving mid-conversion is lost, as on the part
+*/
+static void adc_start(uint64_t at)
+{
+    if(!adc.busy)
+    {
+        adc.busy = 1;
+        uint64_t div = ((ADCCTL1 & ADCDIV) >> 5) + 1;
+        adc.done = at + (30 * div * SIM_PS_PER_S) / sim_smclk_hz;          // 16 sample + 14 convert clocks
+    }
+}
+
+static void adc_sync(void)
+{
+    const uint16_t go = ADCSC | ADCENC | ADCON;
+    if(((ADCCTL0 & go) == go) && ((ADCCTL1 & ADCSHS) == 0))
+    {
+        ADCCTL0 &= ~ADCSC;
+        adc_start(sim_now);
+    }
+}
+
+static void adc_event(void)
+{
+    ADCMEM0 = adc.sample ? adc.sample(adc.ctx, ADCMCTL0 & 0x000F) : 0;
+    ADCIFG |= ADCIFG0;
+    adc.busy = 0;
+}
+
+void sim_set_adc_source(uint16_t (*sample)(void *ctx, int channel), void *ctx)
+{
+    adc.sample = sample;
+    adc.ctx = ctx;
+}
+
+//-- digital I/O -------------------------------------------
+
+uint8_t sim_port_in(int port)
+{
+    if(port_src[port].read)
+    {
+        return port_src[port].read(port_src[port].ctx, port);
+    }
+    sim_port_t *p = &sim_port[port];
+    uint8_t undriven = (uint8_t)~port_src[port].ext_mask;
+    uint8_t in = (p->ren & p->out & undriven) | (port_src[port].ext & port_src[port].ext_mask);
+    return (uint8_t)((p->dir & p->out) | (~p->dir & in));
+}
+
+uint16_t sim_port_iv(int port)
+{
+    sim_port_t *p = &sim_port[port];
+    int n;
+    for(n = 0; n < 8; ++n)
+    {
+        if(p->ifg & p->ie & (1u << n))
+        {
+            p->ifg &= (uint8_t)~(1u << n);
+            return (uint16_t)(2 * (n + 1));
+        }
+    }
+    return 0;
+}
+
+void sim_set_port_source(int port, uint8_t (*read)(void *ctx, int port), void *ctx)
+{
+    port_src[port].read = read;
+    port_src[port].ctx = ctx;
+}
+
+void sim_drive_pin(int port, uint8_t bit, int level)
+{
+    uint8_t old = (port_src[port].ext_mask & bit) ? (port_src[port].ext & bit) : (sim_port[port].ren & sim_port[port].out & bit);
+    port_src[port].ext_mask |= bit;
+    if(level)
+    {
+        port_src[port].ext |= bit;
+    }
+    else
+    {
+        port_src[port].ext &= (uint8_t)~bit;
+    }
+    uint8_t now = port_src[port].ext & bit;
+    if(old != now)
+    {
+        int falling = (sim_port[port].ies & bit) != 0;
+        if((falling && !now) || (!falling && now))
+        {
+            sim_port[port].ifg |= bit;
+        }
+    }
+}
+
+//-- interrupts --------------------------------------------
+
+static int vector_pending(int v)
+{
+    switch(v)
+    {
+        case SIM_VEC_TIMER0_B0:
+        case SIM_VEC_TIMER1_B0:
+        case SIM_VEC_TIMER2_B0:
+        case SIM_VEC_TIMER3_B0:
+        {
+            sim_timer_t *t = &sim_tb[(v - SIM_VEC_TIMER0_B0) / 2];
+            return (t->cctl[0] & (CCIE | CCIFG)) == (CCIE | CCIFG);
+        }
+        case SIM_VEC_TIMER0_B1:
+        case SIM_VEC_TIMER1_B1:
+        case SIM_VEC_TIMER2_B1:
+        case SIM_VEC_TIMER3_B1:
+        {
+            int i = (v - SIM_VEC_TIMER0_B1) / 2;
+            sim_timer_t *t = &sim_tb[i];
+            int n;
+            for(n = 1; n < timer_ccrs(i); ++n)
+            {
+                if((t->cctl[n] & (CCIE | CCIFG)) == (CCIE | CCIFG))
+                {
+                    return 1;
+                }
+            }
+            return (t->ctl & (TBIE | TBIFG)) == (TBIE | TBIFG);
+        }
+        case SIM_VEC_EUSCI_A1:
+            return (UCA1IE & sim_uca1ifg) != 0;
+        case SIM_VEC_EUSCI_B0:
+            return (UCB0IE & UCB0IFG) != 0;
+        case SIM_VEC_ADC:
+            return (ADCIE & ADCIFG) != 0;
+        case SIM_VEC_PORT1:
+        case SIM_VEC_PORT2:
+        case SIM_VEC_PORT3:
+        case SIM_VEC_PORT4:
+        {
+            sim_port_t *p = &sim_port[v - SIM_VEC_PORT1 + 1];
+            return (p->ie & p->ifg) != 0;
+        }
+        default:
+            return 0;
+    }
+}
+
+static void dispatch(void)
+{
+    while(sr & GIE)
+    {
+        int v;
+        for(v = 0; v < SIM_VEC_COUNT; ++v)
+        {
+            if(isr_table[v] && vector_pending(v))
+            {
+                break;
+            }
+        }
+        if(v == SIM_VEC_COUNT)
+        {
+            return;
+        }
+
+        if(dispatch_at != sim_now)
+        {
+            dispatch_at = sim_now;
+            dispatch_count = 0;
+        }
+        if(++dispatch_count > MAX_DISPATCH)
+        {
+            fprintf(stderr, "sim: vector %d never clears its flag at t=%.6f s\n", v, sim_seconds());
+            stalled = 1;
+            longjmp(run_jmp, 1);
+        }
+
+        // single-source flags clear on acceptance
+        if((v <= SIM_VEC_TIMER3_B1) && ((v % 2) == 0))
+        {
+            sim_tb[v / 2].cctl[0] &= ~CCIFG;
+        }
+        else if(v == SIM_VEC_ADC)
+        {
+            ADCIFG &= ~ADCIFG0;
+        }
+
+        uint16_t saved = sr;
+        uint16_t *outer = isr_saved_sr;
+        isr_saved_sr = &saved;
+        sr = 0;
+        isr_table[v]();
+        if(v == SIM_VEC_EUSCI_B0)
+        {
+            i2c_after_isr();
+        }
+        else if(v == SIM_VEC_EUSCI_A1)
+        {
+            uart_sync();
+        }
+        sr = saved;
+        isr_saved_sr = outer;
+    }
+}
+
+void sim_bis_sr(uint16_t bits)
+{
+    sr |= bits;
+    dispatch();
+    while(sr & CPUOFF)
+    {
+        step(NEVER);
+    }
+}
+
+void sim_bic_sr(uint16_t bits)
+{
+    sr &= ~bits;
+}
+
+void sim_bic_sr_on_exit(uint16_t bits)
+{
+    if(isr_saved_sr)
+    {
+        *isr_saved_sr &= ~bits;
+    }
+}
+
+uint16_t sim_get_sr(void)
+{
+    return sr;
+}
+
+void sim_set_sr(uint16_t value)
+{
+    sr = value;
+    dispatch();
+}
+
+void sim_attach_isr(int vector, sim_isr_t isr)
+{
+    isr_table[vector] = isr;
+}
+
+//-- time ---------------------------------------------------
+
+static void sync_all(void)
+{
+    int i;
+    cs_sync();
+    for(i = 0; i < 4; ++i)
+    {
+        timer_sync(i);
+    }
+    i2c_sync();
+    slave_sync();
+    uart_sync();
+    adc_sync();
+}
+
+/**
+* advances to the next event or limit, whichever is first, and services it
+*/
+static void step(uint64_t limit)
+{
+    int i;
+    sync_all();
+
+    uint64_t next = min64(limit, end_ps);
+    for(i = 0; i < 4; ++i)
+    {
+        next = min64(next, timer_next_event(i));
+    }
+    next = min64(next, i2c.next);
+    next = min64(next, slave.next);
+    next = min64(next, uart.next);
+    if(adc.busy)
+    {
+        next = min64(next, adc.done);
+    }
+    for(i = 0; i < event_count; ++i)
+    {
+        next = min64(next, events[i].next);
+    }
+    if(next < sim_now)
+    {
+        next = sim_now;
+    }
+
+    for(i = 0; i < 4; ++i)
+    {
+        timer_advance(i, next);
+    }
+    sim_now = next;
+
+    if(i2c.next <= sim_now)
+    {
+        i2c_event();
+    }
+    if(slave.next <= sim_now)
+    {
+        slave_event();
+    }
+    if(uart.next <= sim_now)
+    {
+        uart_event();
+    }
+    if(adc.busy && (adc.done <= sim_now))
+    {
+        adc_event();
+    }
+    for(i = 0; i < event_count; ++i)
+    {
+        if(events[i].next <= sim_now)
+        {
+            events[i].next += events[i].period;
+            events[i].fn(events[i].ctx);
+        }
+    }
+
+    if(sim_now >= end_ps)
+    {
+        longjmp(run_jmp, 1);
+    }
+    dispatch();
+}
+
+void sim_delay_cycles(unsigned long cycles)
+{
+    uint64_t target = sim_now + (uint64_t)cycles * mclk_ps();
+    sync_all();
+    dispatch();
+    while(sim_now < target)
+    {
+        step(target);
+    }
+}
+
+int sim_every(uint64_t period_ps, void (*fn)(void *ctx), void *ctx)
+{
+    if(event_count == MAX_EVENTS)
+    {
+        return -1;
+    }
+    events[event_count].period = period_ps;
+    events[event_count].next = sim_now + period_ps;
+    events[event_count].fn = fn;
+    events[event_count].ctx = ctx;
+    return event_count++;
+}
+
+void sim_event_restart(int id)
+{
+    events[id].next = sim_now + events[id].period;
+}
+
+void sim_i2c_attach(const sim_i2c_dev_t *dev)
+{
+    if(i2c_dev_count < MAX_I2C_DEVS)
+    {
+        i2c_devs[i2c_dev_count++] = *dev;
+    }
+}
+
+void sim_reset(void)
+{
+    sim_now = 0;
+    WDTCTL = PM5CTL0 = 0;
+    SYSCFG0 = FRWPPW | DFWP | PFWP;
+    CSCTL0 = CSCTL3 = CSCTL5 = CSCTL6 = CSCTL7 = CSCTL8 = FRCTL0 = 0;
+    CSCTL1 = DCORSEL_1;
+    CSCTL2 = CSCTL2_RESET;
+    CSCTL4 = SELA__REFOCLK;
+    cs_sync();
+    fram_warned = 0;
+    memset(sim_port, 0, sizeof(sim_port));
+    memset(sim_tb, 0, sizeof(sim_tb));
+    memset(timer_state, 0, sizeof(timer_state));
+    sim_ucb0ctlw0 = UCSWRST;
+    UCB0CTLW1 = UCB0BRW = sim_ucb0statw = UCB0TBCNT = UCB0I2COA0 = UCB0I2CSA = UCB0IE = UCB0IFG = 0;
+    UCB0RXBUF = UCB0TXBUF = 0;
+    ADCCTL0 = ADCCTL1 = ADCCTL2 = ADCMCTL0 = ADCMEM0 = ADCIE = ADCIFG = 0;
+    memset(&i2c, 0, sizeof(i2c));
+    i2c.next = NEVER;
+    i2c_dev_count = 0;
+    memset(&slave, 0, sizeof(slave));
+    slave.next = NEVER;
+    sim_i2c_stretch_ps = 0;
+    UCA1CTLW0 = UCSWRST;
+    UCA1BRW = UCA1MCTLW = UCA1STATW = UCA1IE = 0;
+    sim_uca1ifg = UCTXIFG;
+    sim_uca1rxbuf = sim_uca1txbuf = 0;
+    memset(&uart, 0, sizeof(uart));
+    uart.next = NEVER;
+    memset(&adc, 0, sizeof(adc));
+    memset(port_src, 0, sizeof(port_src));
+    memset(isr_table, 0, sizeof(isr_table));
+    event_count = 0;
+    sr = 0;
+    isr_saved_sr = NULL;
+    stalled = 0;
+    dispatch_count = 0;
+}
+
+int sim_run(int (*entry)(void), double seconds)
+{
+    end_ps = sim_now + (uint64_t)(seconds * (double)SIM_PS_PER_S);
+    if(setjmp(run_jmp) == 0)
+    {
+        entry();
+        return -1;
+    }
+    return stalled ? -1 : 0;
+}
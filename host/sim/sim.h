@@ -0,0 +1,132 @@
+/**
+* @file
+* @brief Host-side MSP430FR2355 peripheral model
+*
+* Runs an unmodified firmware image on the host. Time only advances inside
+* __delay_cycles(), low-power waits and register accesses that the real part
+* would stall on; ISRs are dispatched at the simulated instant their flag
+* becomes pending.
+*/
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+#define SIM_PS_PER_S        1000000000000ULL
+
+// interrupt vectors in hardware priority order (highest first)
+enum {
+    SIM_VEC_TIMER0_B0,
+    SIM_VEC_TIMER0_B1,
+    SIM_VEC_TIMER1_B0,
+    SIM_VEC_TIMER1_B1,
+    SIM_VEC_TIMER2_B0,
+    SIM_VEC_TIMER2_B1,
+    SIM_VEC_TIMER3_B0,
+    SIM_VEC_TIMER3_B1,
+    SIM_VEC_EUSCI_A1,
+    SIM_VEC_EUSCI_B0,
+    SIM_VEC_ADC,
+    SIM_VEC_PORT1,
+    SIM_VEC_PORT2,
+    SIM_VEC_PORT3,
+    SIM_VEC_PORT4,
+    SIM_VEC_COUNT
+};
+
+typedef void (*sim_isr_t)(void);
+
+/**
+* an I2C slave on the simulated bus
+*/
+typedef struct {
+    uint8_t addr;
+    void *ctx;
+    void (*start)(void *ctx, int read);     // addressed, read = 1 for master receive
+    void (*write)(void *ctx, uint8_t byte); // byte from the master
+    uint8_t (*read)(void *ctx);             // byte to the master
+    void (*stop)(void *ctx);
+} sim_i2c_dev_t;
+
+extern uint64_t sim_now;                    // simulated time in ps
+extern uint32_t sim_mclk_hz, sim_smclk_hz, sim_aclk_hz;
+extern uint64_t sim_i2c_stretch_ps;         // time an external master was held by clock stretching
+
+/**
+* resets all registers and clears attached devices and events
+*/
+void sim_reset(void);
+
+/**
+* attaches a firmware ISR to a vector
+*/
+void sim_attach_isr(int vector, sim_isr_t isr);
+
+/**
+* attaches a slave to the I2C bus
+*/
+void sim_i2c_attach(const sim_i2c_dev_t *dev);
+
+/**
+* an external master writes to this MCU as an I2C slave
+*
+* A byte that completes while RXBUF still holds the last one is stretched
+* until the firmware takes it, as the eUSCI does.
+*
+* @param hz: the master's SCL rate
+* @param done: called after STOP, acked = 0 if the address was not ours
+* @return: 0, or -1 if a write is already on the bus
+*/
+int sim_i2c_slave_write(uint8_t addr, const uint8_t *bytes, int len, uint32_t hz,
+                        void (*done)(void *ctx, int acked), void *ctx);
+
+/**
+* receives every byte the firmware sends out of the eUSCI_A1 UART
+*/
+void sim_uart_attach(void (*tx)(void *ctx, uint8_t byte), void *ctx);
+
+/**
+* a byte arrives on the UART's RXD, overwriting RXBUF if it wasn't read
+*/
+void sim_uart_rx(uint8_t byte);
+
+/**
+* calls fn every period_ps of simulated time
+*
+* @return: event id for sim_event_restart()
+*/
+int sim_every(uint64_t period_ps, void (*fn)(void *ctx), void *ctx);
+
+/**
+* restarts a periodic event so its next call is one full period from now
+*/
+void sim_event_restart(int id);
+
+/**
+* supplies the ADC conversion result for an input channel
+*/
+void sim_set_adc_source(uint16_t (*sample)(void *ctx, int channel), void *ctx);
+
+/**
+* overrides the level read back on a port's input pins
+*/
+void sim_set_port_source(int port, uint8_t (*read)(void *ctx, int port), void *ctx);
+
+/**
+* drives an external signal onto a port pin, raising PxIFG on the selected edge
+*/
+void sim_drive_pin(int port, uint8_t bit, int level);
+
+/**
+* runs a firmware entry point until the given simulated time has passed
+*
+* @return: 0 when time ran out, -1 if the firmware returned or stalled
+*/
+int sim_run(int (*entry)(void), double seconds);
+
+/**
+* simulated time in seconds
+*/
+double sim_seconds(void);
+
+#endif
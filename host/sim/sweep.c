@@ -0,0 +1,289 @@
+/**
+* @file
+* @brief Monte Carlo controller-tuning sweep over the plant model
+*
+* usage: sweep <sweep.cfg> [jobs]
+*
+* Every controller setting is run against the same set of randomly drawn
+* plants so the rankings compare like with like. Each session runs in its own
+* forked process because the firmware image keeps its state in globals; up to
+* `jobs` sessions run at once.
+*/
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "controller.h"
+
+#define MAX_RANGES          16
+#define MAX_WINDOWS         9
+
+typedef struct {
+    char key[32];
+    double lo, hi;
+} range_t;
+
+typedef struct {
+    sim_config_t base;
+    range_t ranges[MAX_RANGES];
+    int range_count;
+    uint8_t windows[MAX_WINDOWS];
+    int window_count;
+    int runs;
+} sweep_t;
+
+typedef struct {
+    plant_metrics_t m;
+    int ok;
+} result_t;
+
+typedef struct {
+    uint8_t window;
+    double settle_sum, overshoot_sum, overshoot_max, switches_sum;
+    int settled, failed;
+} summary_t;
+
+static char *trim(char *s)
+{
+    while(isspace((unsigned char)*s))
+    {
+        ++s;
+    }
+    char *end = s + strlen(s);
+    while((end > s) && isspace((unsigned char)end[-1]))
+    {
+        *--end = '\0';
+    }
+    return s;
+}
+
+static int sweep_load(sweep_t *sw, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if(f == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    char line[256];
+    int line_no = 0, ret = 0, presses_seen = 0;
+    while(fgets(line, sizeof(line), f))
+    {
+        ++line_no;
+        char *hash = strchr(line, '#'), *eq;
+        if(hash)
+        {
+            *hash = '\0';
+        }
+        if((eq = strchr(line, '=')) == NULL)
+        {
+            continue;
+        }
+        *eq = '\0';
+        char *key = trim(line), *value = trim(eq + 1);
+        int bad = 0;
+
+        if(strcmp(key, "runs") == 0)
+        {
+            sw->runs = atoi(value);
+            bad = sw->runs <= 0;
+        }
+        else if(strcmp(key, "windows") == 0)
+        {
+            char *tok;
+            sw->window_count = 0;
+            for(tok = strtok(value, " ,"); tok && (sw->window_count < MAX_WINDOWS); tok = strtok(NULL, " ,"))
+            {
+                int n = atoi(tok);
+                bad |= (n < 1) || (n > MAX_WINDOWS);
+                sw->windows[sw->window_count++] = (uint8_t)n;
+            }
+        }
+        else if(strstr(value, ".."))
+        {
+            range_t *r = &sw->ranges[sw->range_count];
+            bad = (sw->range_count == MAX_RANGES) || (sscanf(value, "%lf .. %lf", &r->lo, &r->hi) != 2) ||
+                  (config_set(&sw->base, key, value) != 0);
+            if(!bad)
+            {
+                snprintf(r->key, sizeof(r->key), "%s", key);
+                ++sw->range_count;
+            }
+        }
+        else
+        {
+            if((strcmp(key, "press") == 0) && !presses_seen++)
+            {
+                sw->base.press_count = 0;
+            }
+            bad = config_set(&sw->base, key, value) != 0;
+        }
+
+        if(bad)
+        {
+            fprintf(stderr, "%s:%d: bad setting '%s'\n", path, line_no, key);
+            ret = -1;
+        }
+    }
+    fclose(f);
+    return ret;
+}
+
+/**
+* draws run r's plant; the same r gives the same plant for every setting
+*/
+static void sample_plant(const sweep_t *sw, int r, sim_config_t *cfg)
+{
+    uint64_t state = 0x9E3779B97F4A7C15ULL * (uint64_t)(r + 1);
+    int k;
+
+    *cfg = sw->base;
+    cfg->seed = sw->base.seed + (uint64_t)r;
+    for(k = 0; k < sw->range_count; ++k)
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        double u = (double)((state * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+        char value[32];
+        snprintf(value, sizeof(value), "%.17g", sw->ranges[k].lo + u * (sw->ranges[k].hi - sw->ranges[k].lo));
+        config_set(cfg, sw->ranges[k].key, value);
+    }
+}
+
+static void run_job(const sweep_t *sw, int job, result_t *out)
+{
+    sim_config_t cfg;
+    sample_plant(sw, job % sw->runs, &cfg);
+    controller_set_window(sw->windows[job / sw->runs]);
+    out->ok = session_run(&cfg, &out->m, NULL) == 0;
+}
+
+static int cmp_summary(const void *a, const void *b)
+{
+    const summary_t *x = a, *y = b;
+    double fx = (double)x->settled, fy = (double)y->settled;
+    if(fx != fy)
+    {
+        return fx < fy ? 1 : -1;            // most sessions settled first
+    }
+    double sx = x->settle_sum / (x->settled ? x->settled : 1), sy = y->settle_sum / (y->settled ? y->settled : 1);
+    if(sx != sy)
+    {
+        return sx < sy ? -1 : 1;
+    }
+    if(x->overshoot_sum != y->overshoot_sum)
+    {
+        return x->overshoot_sum < y->overshoot_sum ? -1 : 1;
+    }
+    return (x->switches_sum > y->switches_sum) - (x->switches_sum < y->switches_sum);
+}
+
+int main(int argc, char **argv)
+{
+    sweep_t sw;
+    memset(&sw, 0, sizeof(sw));
+    config_defaults(&sw.base);
+    sw.runs = 100;
+    sw.windows[0] = 3;
+    sw.window_count = 1;
+
+    if(argc < 2)
+    {
+        fprintf(stderr, "usage: %s <sweep.cfg> [jobs]\n", argv[0]);
+        return 1;
+    }
+    if(sweep_load(&sw, argv[1]) != 0)
+    {
+        return 1;
+    }
+    long jobs = (argc > 2) ? atol(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN);
+    if(jobs < 1)
+    {
+        jobs = 1;
+    }
+
+    int total = sw.runs * sw.window_count;
+    result_t *results = mmap(NULL, sizeof(result_t) * (size_t)total, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(results == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+
+    // process pool: one fresh firmware image per session
+    int next = 0, running = 0;
+    while((next < total) || (running > 0))
+    {
+        if((next < total) && (running < jobs))
+        {
+            pid_t pid = fork();
+            if(pid == 0)
+            {
+                run_job(&sw, next, &results[next]);
+                _exit(0);
+            }
+            if(pid < 0)
+            {
+                perror("fork");
+                return 1;
+            }
+            ++next;
+            ++running;
+            continue;
+        }
+        if(wait(NULL) > 0)
+        {
+            --running;
+        }
+    }
+
+    summary_t summary[MAX_WINDOWS];
+    int w, r;
+    for(w = 0; w < sw.window_count; ++w)
+    {
+        summary_t *s = &summary[w];
+        memset(s, 0, sizeof(*s));
+        s->window = sw.windows[w];
+        for(r = 0; r < sw.runs; ++r)
+        {
+            const result_t *res = &results[w * sw.runs + r];
+            if(!res->ok)
+            {
+                ++s->failed;
+                continue;
+            }
+            if(res->m.settling_time >= 0)
+            {
+                ++s->settled;
+                s->settle_sum += res->m.settling_time;
+            }
+            s->overshoot_sum += res->m.overshoot;
+            if(res->m.overshoot > s->overshoot_max)
+            {
+                s->overshoot_max = res->m.overshoot;
+            }
+            s->switches_sum += res->m.switches;
+        }
+    }
+    qsort(summary, (size_t)sw.window_count, sizeof(summary[0]), cmp_summary);
+
+    printf("%d sessions, %d plants per setting, %ld jobs\n\n", total, sw.runs, jobs);
+    printf("rank  window  settled  settle_s  overshoot_C  max_overshoot_C  switches  stalled\n");
+    for(w = 0; w < sw.window_count; ++w)
+    {
+        const summary_t *s = &summary[w];
+        int n = sw.runs - s->failed;
+        printf("%4d  %6u  %6.1f%%  %8.1f  %11.2f  %15.2f  %8.1f  %7d\n", w + 1, s->window,
+            100.0 * s->settled / (n ? n : 1), s->settled ? s->settle_sum / s->settled : -1.0,
+            s->overshoot_sum / (n ? n : 1), s->overshoot_max, s->switches_sum / (n ? n : 1), s->failed);
+    }
+    return 0;
+}
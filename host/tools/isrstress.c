@@ -0,0 +1,404 @@
+/**
+* @file
+* @brief Stress test for common/isr_share.h with interrupts at random points
+*
+* usage: isrstress [seconds per test]
+*
+* A host thread stands in for the MSP430: a one-shot SIGALRM, re-armed at a
+* random 2-50 us each time, is the interrupt, and main runs in between with
+* no idea when it will be stopped. The intrinsics the header uses are
+* implemented here instead of by the simulator, so __disable_interrupt()
+* blocks the signal exactly as clearing GIE holds off an ISR, and the ISR
+* itself runs with it blocked.
+*
+* Each test checks an invariant that a torn or lost update would break and
+* prints its counts; the exit status is 1 if any test saw an error.
+*/
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "common/isr_share.h"
+
+#define GIE     0x0008
+
+static volatile sig_atomic_t gie = 1;
+static sigset_t irq_set;
+
+//-- intrinsics, see include/intrinsics.h -------------
+
+void sim_delay_cycles(unsigned long cycles)
+{
+    (void)cycles;
+}
+
+void sim_bis_sr(uint16_t bits)
+{
+    if(bits & GIE)
+    {
+        gie = 1;
+        sigprocmask(SIG_UNBLOCK, &irq_set, NULL);
+    }
+}
+
+void sim_bic_sr(uint16_t bits)
+{
+    if(bits & GIE)
+    {
+        sigprocmask(SIG_BLOCK, &irq_set, NULL);
+        gie = 0;
+    }
+}
+
+void sim_bic_sr_on_exit(uint16_t bits)
+{
+    (void)bits;
+}
+
+uint16_t sim_get_sr(void)
+{
+    return gie ? GIE : 0;
+}
+
+void sim_set_sr(uint16_t sr)
+{
+    if(sr & GIE)
+    {
+        sim_bis_sr(GIE);
+    }
+    else
+    {
+        sim_bic_sr(GIE);
+    }
+}
+
+//-- interrupt source ---------------------------------
+
+static uint32_t isr_rng = 0x2545F491, main_rng = 0x9E3779B9;     // one each, so neither tears the other
+static volatile unsigned long irqs;
+static void (*volatile isr)(void);
+static volatile unsigned long errors;
+
+// xorshift, safe in the handler
+static uint32_t random_u32(uint32_t *rng)
+{
+    *rng ^= *rng << 13;
+    *rng ^= *rng >> 17;
+    *rng ^= *rng << 5;
+    return *rng;
+}
+
+static void arm(void)
+{
+    struct itimerval t = {{0, 0}, {0, 2 + (random_u32(&isr_rng) % 49)}};
+    setitimer(ITIMER_REAL, &t, NULL);
+}
+
+static void interrupt(int sig)
+{
+    (void)sig;
+    gie = 0;                            // the kernel has blocked the signal, as the CPU clears GIE
+    irqs++;
+    isr();
+    gie = 1;
+    arm();
+}
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// now and then main is busy elsewhere for 100 us, so the rings run full and empty
+static void stall(void)
+{
+    if((random_u32(&main_rng) & 0xFF) == 0)
+    {
+        double end = now() + 100e-6;
+        while(now() < end);
+    }
+}
+
+//-- ring: ISR to main --------------------------------
+
+static uint8_t rx_buf[32];
+static Ring rx = RING_INIT(rx_buf);
+static uint8_t rx_next_put, rx_next_get;
+static unsigned long rx_full;
+
+static void rx_isr(void)
+{
+    int n = 1 + (random_u32(&isr_rng) % 8);     // a burst of bytes arrives
+    while(n--)
+    {
+        if(!ring_put(&rx, rx_next_put))
+        {
+            rx_full++;
+            break;
+        }
+        rx_next_put++;
+    }
+}
+
+static unsigned long rx_main(void)
+{
+    uint8_t byte;
+    stall();
+    if(ring_room(&rx) > (random_u32(&main_rng) & 7))
+    {
+        return 0;                       // keep it nearly full, so the ISR fills slots just emptied
+    }
+    if(!ring_get(&rx, &byte))
+    {
+        return 0;
+    }
+    if(byte != rx_next_get)
+    {
+        errors++;
+    }
+    rx_next_get = byte + 1;
+    return 1;
+}
+
+static void rx_finish(void)
+{
+    uint8_t byte;
+    while(ring_get(&rx, &byte))
+    {
+        if(byte != rx_next_get)
+        {
+            errors++;
+        }
+        rx_next_get = byte + 1;
+    }
+    if(rx_next_get != rx_next_put)
+    {
+        errors++;
+    }
+    printf("  %lu full", rx_full);
+}
+
+//-- ring: main to ISR --------------------------------
+
+static uint8_t tx_buf[128];
+static Ring tx = RING_INIT(tx_buf);
+static uint8_t tx_next_put, tx_next_get;
+static unsigned long tx_empty;
+
+static void tx_isr(void)
+{
+    int n = 1 + (random_u32(&isr_rng) % 8);     // the UART takes a few bytes
+    uint8_t byte;
+    while(n--)
+    {
+        if(!ring_get(&tx, &byte))
+        {
+            tx_empty++;
+            break;
+        }
+        if(byte != tx_next_get)
+        {
+            errors++;
+        }
+        tx_next_get = byte + 1;
+    }
+}
+
+static unsigned long tx_main(void)
+{
+    stall();
+    if(ring_count(&tx) > (random_u32(&main_rng) & 7))
+    {
+        return 0;                       // keep it shallow, so the ISR reads slots just filled
+    }
+    if(!ring_put(&tx, tx_next_put))
+    {
+        return 0;
+    }
+    tx_next_put++;
+    return 1;
+}
+
+static void tx_finish(void)
+{
+    while(ring_count(&tx))
+    {
+        tx_isr();
+    }
+    if(tx_next_get != tx_next_put)
+    {
+        errors++;
+    }
+    printf("  %lu empty", tx_empty);
+}
+
+//-- events -------------------------------------------
+
+// the ISR posts bits 0-7, main posts 8-15 and takes them all
+static Events events;
+static unsigned long posted[16], taken[16];
+
+static void events_isr(void)
+{
+    int bit = random_u32(&isr_rng) % 8;
+    if(!(events & (1u << bit)))
+    {
+        posted[bit]++;                  // only counted when it sets a clear bit
+    }
+    events_post(&events, 1u << bit);
+}
+
+static unsigned long events_main(void)
+{
+    int bit = 8 + (random_u32(&main_rng) % 8);
+    if(!(events & (1u << bit)))
+    {
+        posted[bit]++;
+    }
+    events_post(&events, 1u << bit);
+
+    uint16_t mask = (uint16_t)random_u32(&main_rng);
+    uint16_t got = events_take(&events, mask);
+    if(got & ~mask)
+    {
+        errors++;
+    }
+    for(bit = 0; bit < 16; bit++)
+    {
+        if(got & (1u << bit))
+        {
+            taken[bit]++;
+        }
+    }
+    return 1;
+}
+
+static void events_finish(void)
+{
+    uint16_t got = events_take(&events, 0xFFFF);
+    unsigned long lost = 0;
+    int bit;
+    for(bit = 0; bit < 16; bit++)
+    {
+        if(got & (1u << bit))
+        {
+            taken[bit]++;
+        }
+        lost += posted[bit] - taken[bit];
+    }
+    errors += lost;
+    printf("  %lu lost", lost);
+}
+
+//-- snapshot -----------------------------------------
+
+// every field derives from n, so a torn copy doesn't check out
+typedef struct {
+    uint32_t n;
+    uint16_t words[10];
+    uint32_t check;
+} Sample;
+
+static Sample sample = {0, {0}, 0xFFFFFFFF};  // a valid n = 0
+static Snapshot snap = SNAPSHOT_INIT(sample);
+static uint32_t snap_n, snap_last;
+
+static void sample_fill(Sample *s, uint32_t n)
+{
+    int i;
+    s->n = n;
+    for(i = 0; i < 10; i++)
+    {
+        s->words[i] = (uint16_t)(n * (i + 3));
+    }
+    s->check = ~n;
+}
+
+static void snap_isr(void)
+{
+    Sample s;
+    sample_fill(&s, ++snap_n);
+    snap_write(&snap, &s);
+}
+
+static unsigned long snap_main(void)
+{
+    Sample got, want;
+    snap_read(&snap, &got);
+    sample_fill(&want, got.n);
+    if((memcmp(&got, &want, sizeof(got)) != 0) || (got.n < snap_last))
+    {
+        errors++;
+    }
+    snap_last = got.n;
+    return 1;
+}
+
+static void snap_finish(void)
+{
+    printf("  %u writes", (unsigned)snap_n);
+}
+
+//-- driver -------------------------------------------
+
+typedef struct {
+    const char *name;
+    void (*isr)(void);
+    unsigned long (*main_step)(void);   // returns operations done
+    void (*finish)(void);               // interrupts off; drain and check what's left
+} Test;
+
+static const Test tests[] = {
+    {"ring isr->main", rx_isr, rx_main, rx_finish},
+    {"ring main->isr", tx_isr, tx_main, tx_finish},
+    {"events", events_isr, events_main, events_finish},
+    {"snapshot", snap_isr, snap_main, snap_finish},
+};
+
+int main(int argc, char **argv)
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 1.0;
+    unsigned long failed = 0;
+    size_t i;
+
+    sigemptyset(&irq_set);
+    sigaddset(&irq_set, SIGALRM);
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = interrupt;
+    sigaction(SIGALRM, &sa, NULL);
+
+    for(i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        const Test *t = &tests[i];
+        unsigned long ops = 0, steps = 0;
+        errors = 0;
+        irqs = 0;
+        isr = t->isr;
+
+        double end = now() + seconds;
+        arm();
+        while(((++steps & 0x3FF) != 0) || (now() < end))
+        {
+            ops += t->main_step();
+        }
+        sim_bic_sr(GIE);
+        struct itimerval off = {{0, 0}, {0, 0}};
+        setitimer(ITIMER_REAL, &off, NULL);
+
+        printf("%-16s %10lu ops %8lu interrupts", t->name, ops, irqs);
+        t->finish();
+        printf("  %lu errors\n", errors);
+        sim_bis_sr(GIE);
+
+        failed += errors;
+    }
+    printf(failed ? "FAIL\n" : "ok\n");
+    return failed ? 1 : 0;
+}
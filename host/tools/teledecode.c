@@ -0,0 +1,124 @@
+/**
+* @file
+* @brief Decodes the controller's binary UART telemetry into CSV
+*
+* usage: teledecode [capture.bin] [out.csv]
+*
+* Scans the capture (stdin by default) for frames, checks length and CRC and
+* writes one CSV row per good frame (stdout by default). Text the console
+* printed in between is skipped. Bad frames and sequence gaps are counted on
+* stderr.
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// see controller/src/telemetry.h
+#define TELEMETRY_SYNC0     0xA5
+#define TELEMETRY_SYNC1     0x5A
+#define TELEMETRY_VERSION   1
+#define TELEMETRY_PAYLOAD   21
+
+static uint16_t crc16_update(uint16_t crc, uint8_t byte)
+{
+    int i;
+    crc ^= (uint16_t)byte << 8;
+    for(i = 0; i < 8; ++i)
+    {
+        crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin, *out = stdout;
+    if((argc > 1) && (strcmp(argv[1], "-") != 0) && ((in = fopen(argv[1], "rb")) == NULL))
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    if((argc > 2) && ((out = fopen(argv[2], "w")) == NULL))
+    {
+        perror(argv[2]);
+        return 1;
+    }
+
+    fprintf(out, "seq,elapsed_sec,lm19_raw,lm19_avg,lm92_raw,lm19_c,lm92_c,pattern,ambient,heat,cool,"
+                 "pending_heat,pending_cool,i2c_nacks,bar_resyncs,bar_dropped,dropped\n");
+
+    // frame: sync0 sync1 len payload crc_lo crc_hi
+    uint8_t frame[3 + 255 + 2];
+    int have = 0, c;
+    unsigned long good = 0, bad = 0, gaps = 0, lost = 0;
+    int have_seq = 0;
+    uint16_t next_seq = 0;
+
+    while((c = fgetc(in)) != EOF)
+    {
+        frame[have++] = (uint8_t)c;
+        if(((have == 1) && (frame[0] != TELEMETRY_SYNC0)) || ((have == 2) && (frame[1] != TELEMETRY_SYNC1)))
+        {
+            have = (frame[have - 1] == TELEMETRY_SYNC0) ? 1 : 0;
+            frame[0] = TELEMETRY_SYNC0;
+            continue;
+        }
+        if((have < 3) || (have < 3 + frame[2] + 2))
+        {
+            continue;
+        }
+
+        int len = frame[2];
+        uint16_t crc = 0xFFFF;
+        int i;
+        for(i = 2; i < 3 + len; ++i)
+        {
+            crc = crc16_update(crc, frame[i]);
+        }
+        const uint8_t *p = frame + 3;
+        if((crc != get16(frame + 3 + len)) || (len < TELEMETRY_PAYLOAD) || (p[0] != TELEMETRY_VERSION))
+        {
+            // not a frame after all: look for the next sync after this one's
+            ++bad;
+            int skip;
+            for(skip = 1; skip < have; ++skip)
+            {
+                if(frame[skip] == TELEMETRY_SYNC0)
+                {
+                    break;
+                }
+            }
+            have -= skip;
+            memmove(frame, frame + skip, have);
+            continue;
+        }
+
+        uint16_t seq = get16(p + 1);
+        if(have_seq && (seq != next_seq))
+        {
+            ++gaps;
+            lost += (uint16_t)(seq - next_seq);
+        }
+        have_seq = 1;
+        next_seq = (uint16_t)(seq + 1);
+        ++good;
+
+        uint8_t mode = p[15], legs = p[16];
+        fprintf(out, "%u,%u,%u,%u,0x%04x,%.2f,%.2f,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", seq, get16(p + 3), get16(p + 5),
+            get16(p + 7), get16(p + 9), (int16_t)get16(p + 11) / 100.0, (int16_t)get16(p + 13) / 100.0, mode & 0x03,
+            (mode >> 2) & 1, legs & 1, (legs >> 1) & 1, (legs >> 2) & 1, (legs >> 3) & 1, p[17], p[18], p[19], p[20]);
+        have = 0;
+    }
+
+    fprintf(stderr, "frames: %lu good, %lu bad, %lu gaps (%lu lost)\n", good, bad, gaps, lost);
+    if(out != stdout)
+    {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,254 @@
+/**
+* @file
+* @brief Converts a controller event trace dump to Chrome trace_event JSON
+*
+* usage: tracejson [console.txt] [trace.json]
+*
+* Reads the debug UART log (stdin by default), takes the last "trace <n>" ...
+* "end" block printed by the 't' command and writes JSON (stdout by default)
+* that chrome://tracing or Perfetto opens as a timeline: ISRs and LCD updates
+* as spans, I2C and mode changes as instants.
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// see controller/src/trace.h and controller/src/profile.h
+#define TR_BOOT             0x01
+#define TR_ISR_ENTER        0x02
+#define TR_ISR_EXIT         0x03
+#define TR_I2C_START        0x04
+#define TR_I2C_STOP         0x05
+#define TR_I2C_NACK         0x06
+#define TR_MODE             0x07
+#define TR_LCD_MODE         0x08
+#define TR_LCD_BEGIN        0x09
+#define TR_LCD_END          0x0A
+#define TR_TASK_BEGIN       0x0B
+#define TR_TASK_END         0x0C
+
+#define ACLK_HZ             32768   // trace timestamps are Timer B0 ACLK counts
+
+// timeline rows
+#define TID_MAIN            1
+#define TID_ISR             2
+#define TID_I2C             3
+
+typedef struct {
+    uint32_t time;
+    uint8_t type, arg;
+} record_t;
+
+static const char *vector_names[] = {
+    "transmit_data", "sched_tick", "record_av", "rtc_tick", "dead_time"};
+static const char *task_names[] = {
+    "sense", "bar_poll", "control", "keypad", "heartbeat", "console", "average", "elapsed", "bar_check"};
+static const char *lcd_parts[] = {"lcd mode", "lcd temperature", "lcd time"};
+static const char *patterns[] = {"off", "cooling", "heating"};
+static const char *lcd_modes[] = {"heat", "cool", "match", "off"};
+
+static const char *name_of(const char **names, size_t count, uint8_t idx)
+{
+    return (idx < count) ? names[idx] : "?";
+}
+
+#define NAME(names, idx)    name_of((names), sizeof(names) / sizeof((names)[0]), (idx))
+
+/**
+* reads the last complete dump in the log
+*
+* @return: records read, or -1 if there is no dump
+*/
+static long read_dump(FILE *in, record_t **out)
+{
+    char line[128];
+    record_t *recs = NULL, *done = NULL;
+    long n = 0, cap = 0, done_n = -1;
+    int in_dump = 0;
+
+    while(fgets(line, sizeof(line), in))
+    {
+        unsigned long count;
+        unsigned time, type, arg;
+        if(sscanf(line, "trace %lu", &count) == 1)
+        {
+            in_dump = 1;
+            n = 0;
+        }
+        else if(in_dump && (strncmp(line, "end", 3) == 0))
+        {
+            in_dump = 0;
+            free(done);
+            done = recs;
+            done_n = n;
+            recs = NULL;
+            cap = 0;
+        }
+        else if(in_dump && (sscanf(line, "%8x %2x %2x", &time, &type, &arg) == 3))
+        {
+            if(n == cap)
+            {
+                cap = cap ? 2 * cap : 512;
+                recs = realloc(recs, cap * sizeof(*recs));
+                if(recs == NULL)
+                {
+                    perror("tracejson");
+                    exit(1);
+                }
+            }
+            recs[n].time = time;
+            recs[n].type = (uint8_t)type;
+            recs[n].arg = (uint8_t)arg;
+            ++n;
+        }
+    }
+    free(recs);
+    *out = done;
+    return done_n;
+}
+
+static int first = 1;
+
+static void emit(FILE *out, const char *name, const char *ph, uint64_t ts, int tid, const char *args)
+{
+    fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%llu,\"pid\":1,\"tid\":%d", first ? "" : ",", name, ph,
+        (unsigned long long)ts, tid);
+    if(ph[0] == 'i')
+    {
+        fprintf(out, ",\"s\":\"t\"");
+    }
+    if(args)
+    {
+        fprintf(out, ",\"args\":{%s}", args);
+    }
+    fprintf(out, "}");
+    first = 0;
+}
+
+static void emit_thread_name(FILE *out, int tid, const char *name)
+{
+    char args[64];
+    snprintf(args, sizeof(args), "\"name\":\"%s\"", name);
+    emit(out, "thread_name", "M", 0, tid, args);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin, *out = stdout;
+    if((argc > 1) && (strcmp(argv[1], "-") != 0) && ((in = fopen(argv[1], "r")) == NULL))
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    record_t *recs;
+    long n = read_dump(in, &recs);
+    if(n < 0)
+    {
+        fprintf(stderr, "tracejson: no complete trace dump in the input\n");
+        return 1;
+    }
+
+    if((argc > 2) && ((out = fopen(argv[2], "w")) == NULL))
+    {
+        perror(argv[2]);
+        return 1;
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    emit_thread_name(out, TID_MAIN, "main");
+    emit_thread_name(out, TID_ISR, "isr");
+    emit_thread_name(out, TID_I2C, "i2c");
+
+    // records are oldest first; the 32-bit ACLK count restarts at every boot
+    uint64_t base = 0, last = 0;
+    int isr_depth = 0, lcd_tid = 0, task_open = 0;
+    long i;
+    for(i = 0; i < n; ++i)
+    {
+        const record_t *r = &recs[i];
+        char args[64];
+        if(r->type == TR_BOOT)
+        {
+            base = last + 1;
+            isr_depth = 0;
+            lcd_tid = 0;
+            task_open = 0;
+        }
+        uint64_t count = base + r->time;
+        while(count < last)
+        {
+            count += 1ULL << 32;                    // clock wrapped (36 h)
+            base += 1ULL << 32;
+        }
+        last = count;
+        uint64_t ts = count * 1000000ULL / ACLK_HZ; // us
+
+        switch(r->type)
+        {
+            case TR_BOOT:
+                fprintf(out, ",\n{\"name\":\"boot\",\"ph\":\"i\",\"ts\":%llu,\"pid\":1,\"tid\":%d,\"s\":\"g\"}",
+                    (unsigned long long)ts, TID_MAIN);
+                break;
+            case TR_ISR_ENTER:
+                emit(out, NAME(vector_names, r->arg), "B", ts, TID_ISR, NULL);
+                ++isr_depth;
+                break;
+            case TR_ISR_EXIT:
+                if(isr_depth)                       // its entry may have been overwritten
+                {
+                    --isr_depth;
+                    emit(out, NAME(vector_names, r->arg), "E", ts, TID_ISR, NULL);
+                }
+                break;
+            case TR_I2C_START:
+            case TR_I2C_STOP:
+            case TR_I2C_NACK:
+                snprintf(args, sizeof(args), "\"addr\":\"0x%02x\"", r->arg);
+                emit(out, (r->type == TR_I2C_START) ? "start" : (r->type == TR_I2C_STOP) ? "stop" : "nack", "i",
+                    ts, TID_I2C, args);
+                break;
+            case TR_MODE:
+                snprintf(args, sizeof(args), "\"pattern\":\"%s\"", NAME(patterns, r->arg));
+                emit(out, "led bar pattern", "i", ts, TID_MAIN, args);
+                break;
+            case TR_LCD_MODE:
+                snprintf(args, sizeof(args), "\"mode\":\"%s\"", NAME(lcd_modes, r->arg));
+                emit(out, "lcd mode", "i", ts, TID_MAIN, args);
+                break;
+            case TR_TASK_BEGIN:
+                emit(out, NAME(task_names, r->arg), "B", ts, TID_MAIN, NULL);
+                task_open = 1;
+                break;
+            case TR_TASK_END:
+                if(task_open)
+                {
+                    emit(out, NAME(task_names, r->arg), "E", ts, TID_MAIN, NULL);
+                    task_open = 0;
+                }
+                break;
+            case TR_LCD_BEGIN:
+                lcd_tid = isr_depth ? TID_ISR : TID_MAIN;
+                emit(out, NAME(lcd_parts, r->arg), "B", ts, lcd_tid, NULL);
+                break;
+            case TR_LCD_END:
+                if(lcd_tid)
+                {
+                    emit(out, NAME(lcd_parts, r->arg), "E", ts, lcd_tid, NULL);
+                    lcd_tid = 0;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    fprintf(out, "\n]}\n");
+
+    free(recs);
+    if(out != stdout)
+    {
+        fclose(out);
+    }
+    return 0;
+}
@@ -12,6 +12,13 @@ uint8_t state_flag;         // 0 = just update temp, 1 = pattern, 2 = window
 uint8_t current_n, current_temp_digit, current_pattern, temp_unit;
 uint8_t change_allowed;   // flag to tell if the incoming data is allowed to change window size or n
 
+// what should be on the display and what the HD44780 has now, row 0 then row 1
+char screen[LCD_CELLS], shadow[LCD_CELLS];
+
+// FRAME_CMD / PATCH_CMD burst in progress
+uint8_t burst_state;      // BURST_ step, 0 = none
+uint8_t burst_pos, burst_left;
+
 char *lcd_strings[] = {
     "static", "toggle", "up counter", "in and out",
     "down counter", "rotate 1 left", "rotate 7 right", "fill left", "none"
@@ -19,6 +26,7 @@ char *lcd_strings[] = {
 char *window_state_str = "set window size";
 char *pattern_state_str = "set pattern";
 uint8_t temp_digits[3] = {'0','0','0'}; 
+uint16_t temp_tenths = 0;   // last reading in 0.1 C
 
 void init_lcd(){
     P1DIR |= BIT0 | BIT1 | BIT4 | BIT5 | BIT6 | BIT7;       // EN, RS, DB4, DB5, DB6, DB7
@@ -30,10 +38,17 @@ void init_lcd(){
     current_pattern = 8;                      // "none"
     temp_unit = 'C';
     change_allowed = 0;
+    burst_state = 0;
+    uint8_t i;
+    for(i = 0; i < LCD_CELLS; i++)
+    {
+        screen[i] = ' ';
+        shadow[i] = ' ';              // matches the display once it has been cleared
+    }
 
     PM5CTL0 &= ~LOCKLPM5;
     
-    __delay_cycles(50000);
+    DELAY_MS(50);
     lcd_set_function();
     DELAY_001;
     lcd_send_command(LCD_DISPLAY_ON);
@@ -72,12 +87,72 @@ void lcd_send_string(char *str){
     }
 }
 
-void lcd_choose_string(uint8_t data) 
+void lcd_put_row(uint8_t row, char *str)
+{
+    char *cell = &screen[row * LCD_COLS];
+    uint8_t i;
+    for(i = 0; i < LCD_COLS; i++)
+    {
+        cell[i] = (*str != '\0') ? *str++ : ' ';
+    }
+}
+
+/**
+* takes the next byte of a frame or patch burst
+*
+* @return: 0 if the byte was thrown away
+*/
+static uint8_t lcd_burst_byte(uint8_t data)
+{
+    switch(burst_state)
+    {
+        case BURST_ROW:
+            burst_pos = (data & 1) * LCD_COLS;
+            burst_state = BURST_COL;
+            break;
+        case BURST_COL:
+            burst_pos += data & (LCD_COLS - 1);
+            burst_state = BURST_LEN;
+            break;
+        case BURST_LEN:
+            burst_left = data;
+            burst_state = burst_left ? BURST_CHARS : 0;
+            break;
+        default:                    // BURST_CHARS
+            if(--burst_left == 0)
+            {
+                burst_state = 0;
+            }
+            if(burst_pos >= LCD_CELLS)
+            {
+                return 0;           // ran off the end of the screen
+            }
+            screen[burst_pos++] = data;
+            break;
+    }
+    return 1;
+}
+
+uint8_t lcd_choose_string(uint8_t data) 
 {   
-    if (data == LOCK)               // always able to lock
+    if (burst_state)
+    {
+        return lcd_burst_byte(data);
+    }
+    else if (data == FRAME_CMD)     // 32 characters follow
+    {
+        burst_pos = 0;
+        burst_left = LCD_CELLS;
+        burst_state = BURST_CHARS;
+    }
+    else if (data == PATCH_CMD)     // row, column, length, characters follow
+    {
+        burst_state = BURST_ROW;
+    }
+    else if (data == LOCK)          // always able to lock
     {
-        DELAY_0001;
-        lcd_send_command(LCD_CLEAR_DISPLAY);
+        lcd_put_row(0, "");
+        lcd_put_row(1, "");
     }
     else
     {
@@ -86,15 +161,11 @@ void lcd_choose_string(uint8_t data)
             switch(data)
             {
                 case WINDOW_CHANGE:
-                    lcd_clear_line(LCD_RETURN_HOME);
-                    DELAY_0001;
-                    lcd_send_string(window_state_str);
+                    lcd_put_row(0, window_state_str);
                     state_flag = 2;
                     break;
                 case PATTERN_CHANGE:
-                    lcd_clear_line(LCD_RETURN_HOME);
-                    DELAY_0001;
-                    lcd_send_string(pattern_state_str);
+                    lcd_put_row(0, pattern_state_str);
                     state_flag = 1;
                     break;
                 case TEMP_UNIT_CHANGE:
@@ -114,11 +185,17 @@ void lcd_choose_string(uint8_t data)
                     change_allowed = 1;
                     break;
                 default:        // it's a temperature digit
+                    if(data < '0' || data > '9')
+                    {
+                        return 0;
+                    }
                     temp_digits[current_temp_digit] = data;
                     current_temp_digit++;
                     if(current_temp_digit > 2)
                     {
                         current_temp_digit = 0;
+                        temp_tenths = ((temp_digits[0] - '0') * 100) + ((temp_digits[1] - '0') * 10) +
+                                      (temp_digits[2] - '0');
                         lcd_set_temperature();
                     }   
                     break;
@@ -131,55 +208,125 @@ void lcd_choose_string(uint8_t data)
                 if (data >= '0' && data <= '7') 
                 {
                     current_pattern = data - '0';
-                    lcd_disp_pattern();
+                    lcd_put_row(0, lcd_strings[current_pattern]);
                 } 
+                else
+                {
+                    state_flag = 0;
+                    change_allowed = 0;
+                    return 0;
+                }
             }
             else                       // update window
             {
                 lcd_set_window_size(data);
-                lcd_disp_pattern();
+                lcd_put_row(0, lcd_strings[current_pattern]);
             }
             state_flag = 0;
             change_allowed = 0;
         }
     }
+    return 1;
 }
 
-void lcd_disp_pattern()
+uint8_t lcd_mode()
 {
-    lcd_clear_line(LCD_RETURN_HOME);
-    DELAY_0001;
-    lcd_send_string((char*)lcd_strings[current_pattern]);
+    uint8_t mode = state_flag;
+    if(temp_unit == 'F')
+    {
+        mode |= BIT7;
+    }
+    if(burst_state)
+    {
+        mode |= BIT6;
+    }
+    return mode;
+}
+
+uint8_t lcd_refresh()
+{
+    uint8_t i, sent = 0;
+    uint8_t addr = 0xFF;            // DDRAM address the HD44780 writes next, 0xFF = unknown
+    for(i = 0; i < LCD_CELLS; i++)
+    {
+        if(screen[i] != shadow[i])
+        {
+            uint8_t ddram = (i < LCD_COLS) ? i : (0x40 + i - LCD_COLS);
+            if(ddram != addr)
+            {
+                lcd_send_command(0x80 | ddram);     // only move when the changes aren't adjacent
+            }
+            lcd_send_data(screen[i]);
+            shadow[i] = screen[i];
+            addr = ddram + 1;
+            sent++;
+        }
+    }
+    if(sent)
+    {
+        lcd_send_command(0x80);     // park the cursor at home
+    }
+    return sent;
 }
 
 void lcd_set_window_size(uint8_t data)
 {
     current_n = data;
-    // set DDRAM to right before bottom right corner
-    lcd_send_command(0x80 | 0x4D);       
-    DELAY_0001;
-    lcd_send_data('N');            
-    lcd_send_data('=');            
-    lcd_send_data(data);        
+    // right before bottom right corner
+    screen[LCD_COLS + 13] = 'N';
+    screen[LCD_COLS + 14] = '=';
+    screen[LCD_COLS + 15] = data;
+}
+
+uint16_t lcd_c_to_f(uint16_t tenths_c)
+{
+    // F = C * 9/5 + 32; 1843/1024 with this rounding term is exact for 0.0-99.9 C
+    return (uint16_t)((((uint32_t)tenths_c * 1843) + 609) >> 10) + 320;
 }
 
 void lcd_set_temperature()
 {    
-    lcd_clear_line(LCD_BOTTOM_LINE);
-    DELAY_0001;
-    lcd_send_data('T');            
-    lcd_send_data('=');            
-    lcd_send_data(temp_digits[0]);
-    lcd_send_data(temp_digits[1]);
-    lcd_send_data('.');
-    lcd_send_data(temp_digits[2]);
-    lcd_send_data(0b11011111);      // degree symbol         
-    lcd_send_data(temp_unit);
+    char *cell = &screen[LCD_COLS];
+    uint16_t t = (temp_unit == 'F') ? lcd_c_to_f(temp_tenths) : temp_tenths;
+    uint8_t hundreds = '0', tens = '0', ones = '0';
+
+    // digits by subtraction: at most 2 + 9 + 9 passes, no divide
+    while(t >= 1000)
+    {
+        t -= 1000;
+        hundreds++;
+    }
+    while(t >= 100)
+    {
+        t -= 100;
+        tens++;
+    }
+    while(t >= 10)
+    {
+        t -= 10;
+        ones++;
+    }
+
+    uint8_t i = 0;
+    cell[i++] = 'T';
+    cell[i++] = '=';
+    if(hundreds != '0')
+    {
+        cell[i++] = hundreds;       // 100.0 F and up
+    }
+    cell[i++] = tens;
+    cell[i++] = ones;
+    cell[i++] = '.';
+    cell[i++] = '0' + t;
+    cell[i++] = 0b11011111;         // degree symbol
+    cell[i++] = temp_unit;
+    while(i < 13)
+    {
+        cell[i++] = ' ';
+    }
     lcd_set_window_size(current_n);
-    lcd_send_command(LCD_RETURN_HOME);           
 }
 
-
 void lcd_set_function(){
     P1OUT &= ~BIT1;                 // RS = 0 for command
     P1OUT = (0x03 << 4);            // Send high nibble
@@ -187,21 +334,21 @@ void lcd_set_function(){
     DELAY_0001;
     P1OUT &= ~BIT0;
 
-    __delay_cycles(30000);
+    DELAY_MS(30);
 
     P1OUT = (0x03 << 4);            // Send high nibble
     P1OUT |= BIT0;                  // Enable pulse
     DELAY_0001;
     P1OUT &= ~BIT0;
 
-    __delay_cycles(30000);
+    DELAY_MS(30);
 
     P1OUT = (0x03 << 4);          // Send high nibble
     P1OUT |= BIT0;                  // Enable pulse
     DELAY_0001;
     P1OUT &= ~BIT0;
 
-    __delay_cycles(30000);
+    DELAY_MS(30);
 
     P1OUT = (0x02 << 4);    // Send low nibble
     P1OUT |= BIT0;
@@ -210,15 +357,3 @@ void lcd_set_function(){
 
     lcd_send_command(LCD_FUNCTION);
 }
-
-void lcd_clear_line(uint8_t cmd)
-{
-    lcd_send_command(cmd);
-    DELAY_0001;
-    uint8_t i = 0;
-    for (i = 0; i < 16; i++) {
-        lcd_send_data(' ');
-        DELAY_0001;
-    }
-    lcd_send_command(cmd);
-}
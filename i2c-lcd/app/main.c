@@ -7,16 +7,38 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "src/lcd.h"
+#include "common/clock.h"
+#include "common/isr_share.h"
 
+// heartbeat: toggles every 5 ticks, every tick for 10 ticks after data arrives
+#define BEAT_TICK_HZ    5
+#define BEAT_SLOW       5
 
-uint8_t data;
 uint8_t data_recieved_count;
-uint8_t data_received;
+volatile uint8_t data_received;
+uint8_t beat_count = 0;
+
+// bytes from the master: the ISR only queues them, main parses and draws
+#define RX_RING_SIZE    32                  // power of 2
+uint8_t rx_buf[RX_RING_SIZE];
+Ring rx_ring = RING_INIT(rx_buf);
+
+// status block answered to every master read, from byte 0 each time
+#define STATUS_VERSION  0                   // major << 4 | minor
+#define STATUS_APPLIED  1                   // refreshes that changed the display, wraps
+#define STATUS_DROPPED  2                   // bytes the parser threw away, stops at 255
+#define STATUS_MODE     3                   // see lcd_mode()
+#define STATUS_QUEUED   4                   // bytes waiting in the ring
+#define STATUS_SIZE     5
+#define FW_VERSION      0x20
+uint8_t status_block[STATUS_SIZE] = {FW_VERSION, 0, 0, 0, 0};
+uint8_t status_idx = 0;
 
 int main(void)
 {
     // Stop watchdog timer
     WDTCTL = WDTPW | WDTHOLD;
+    init_clock();
 
     // I2C Setup
     UCB0CTLW0 &=~UCSWRST;                                 //clear reset register
@@ -39,17 +61,15 @@ int main(void)
     UCB0CTLW0 &= ~UCSWRST;
 
     // 5. Enable Interrupts
-    UCB0IE |= UCRXIE0;          // Enable I2C Rx0 IRQ
+    UCB0IE |= UCRXIE0 | UCTXIE0 | UCSTTIE;    // Rx, Tx (status reads) and start IRQs
 
-     // Timer B0
-    // Math: 1s = (1*10^-6)(D1)(D2)(25k)    D1 = 5, D2 = 8
+     // Timer B0 on ACLK (REFO) so the heartbeat keeps going in LPM3
+    // Math: .2s = (1/32768)(ACLK_TICKS(5)), 6554 ticks
     TB0CTL |= TBCLR;        // Clear timer and dividers
-    TB0CTL |= TBSSEL__SMCLK;  // Source = SMCLK
+    TB0CTL |= TBSSEL__ACLK;   // Source = ACLK
     TB0CTL |= MC__UP;       // Mode UP
-    TB0CTL |= ID__8;         // divide by 8 
-    TB0EX0 |= TBIDEX__5;    // divide by 5 (100)
 
-    TB0CCR0 = 25000;
+    TB0CCR0 = ACLK_TICKS(BEAT_TICK_HZ) - 1;
 
     TB0CCTL0 &= ~CCIFG;     // Clear CCR0
     TB0CCTL0 |= CCIE;       // Enable IRQ
@@ -60,7 +80,6 @@ int main(void)
 
     // variable initiation
 
-    data = 0;
     data_recieved_count = 0;
     data_received = 0;
 
@@ -72,7 +91,28 @@ int main(void)
     PM5CTL0 &= ~LOCKLPM5;
 
     while (true)
-    {   
+    {
+        // sleep in LPM3 until the ISR queues something; the slave eUSCI runs off SCL
+        __disable_interrupt();
+        if (ring_count(&rx_ring) == 0){
+            __bis_SR_register(LPM3_bits | GIE);
+        }
+        __enable_interrupt();
+
+        // parse everything queued, then draw once
+        uint8_t data;
+        while (ring_get(&rx_ring, &data)){
+            UCB0IE |= UCRXIE0;              // room again if the ISR had to stop taking bytes
+            if(!lcd_choose_string(data) && (status_block[STATUS_DROPPED] != 0xFF))
+            {
+                status_block[STATUS_DROPPED]++;
+            }
+        }
+        if(lcd_refresh())
+        {
+            status_block[STATUS_APPLIED]++;
+        }
+        status_block[STATUS_MODE] = lcd_mode();
     }
 }
 
@@ -87,10 +127,22 @@ __interrupt void receive_data(void)
 {
     switch(UCB0IV)             // determines which IFG has been triggered
     {
+    case USCI_I2C_UCSTTIFG:                 // ID 0x06: addressed, a read starts at byte 0
+        status_idx = 0;
+        status_block[STATUS_QUEUED] = ring_count(&rx_ring);
+        break;
     case USCI_I2C_UCRXIFG0:                 // ID 0x16: Rx IFG
-        data_received = 1;
-        data = UCB0RXBUF;                   // retrieve data
-        lcd_choose_string(data);
+        data_received = 1;                  // only the timer ISR reads it, and ISRs don't nest
+        ring_put(&rx_ring, UCB0RXBUF);      // retrieve data; there is room, see below
+        if(ring_room(&rx_ring) == 0)
+        {
+            // ring full: leave the next byte in RXBUF, the bus stretches until main catches up
+            UCB0IE &= ~UCRXIE0;
+        }
+        __bic_SR_register_on_exit(LPM3_bits);
+        break;
+    case USCI_I2C_UCTXIFG0:                 // ID 0x18: Tx IFG
+        UCB0TXBUF = (status_idx < STATUS_SIZE) ? status_block[status_idx++] : 0xFF;
         break;
     default:
         break;
@@ -105,20 +157,23 @@ __interrupt void receive_data(void)
 #pragma vector = TIMER0_B0_VECTOR
 __interrupt void heartbeat_LED(void)
 {
-    P2OUT ^= BIT0;          // P2.0 xOR
     if(data_received != 0)
     {
-        // Math: .2s = (1*10^-6)(D1)(D2)(5k)    D1 = 5, D2 = 8
-        TB0CCR0 = 5000;
+        P2OUT ^= BIT0;      // P2.0 xOR, fast
+        beat_count = 0;
         data_recieved_count++;
         
         if(data_recieved_count == 10)
         {
             data_received = 0;
             data_recieved_count = 0;
-            TB0CCR0 = 25000;
         }
     }
+    else if(++beat_count >= BEAT_SLOW)
+    {
+        P2OUT ^= BIT0;      // P2.0 xOR, 1 s
+        beat_count = 0;
+    }
 
 
     TB0CCTL0 &= ~CCIFG;     // clear flag
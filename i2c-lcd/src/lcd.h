@@ -4,10 +4,11 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <msp430fr2310.h>
+#include "common/clock.h"
 
 // delays
-#define DELAY_0001  __delay_cycles(1000)         // 0.001 s
-#define DELAY_001   __delay_cycles(10000)        // 0.01 s
+#define DELAY_0001  DELAY_MS(1)             // 0.001 s
+#define DELAY_001   DELAY_MS(10)            // 0.01 s
 
 // LCD Commands
 #define LCD_FUNCTION            0x28    // 4 bit, 2 lines
@@ -31,6 +32,18 @@
 #define LOCK                    0x44      // D
 #define CHANGE_PERMITTED        0x47      // G
 
+// bursts: a whole frame, or part of one row, in a single write
+#define FRAME_CMD               0xF0      // then 32 characters, top row first
+#define PATCH_CMD               0xF1      // then row, column, length, characters
+
+#define BURST_ROW               1
+#define BURST_COL               2
+#define BURST_LEN               3
+#define BURST_CHARS             4
+
+#define LCD_COLS                16
+#define LCD_CELLS               32
+
 /**
 * initialize lcd outputs and begin startup process
 */
@@ -52,29 +65,55 @@ void lcd_send(uint8_t data, uint8_t is_data);
 void lcd_send_string(char *str);
 
 /**
-* select a string to send given a choice
+* parse one byte from the master into the screen buffer
 * 
 * @param: byte of data
+* @return: 0 if the byte made no sense here and was thrown away
 */
-void lcd_choose_string(uint8_t data);
+uint8_t lcd_choose_string(uint8_t data);
 
 /**
-* display the current pattern on the LCD
+* send the HD44780 only the cells that differ from what it shows
+*
+* @return: cells sent
 */
-void lcd_disp_pattern();
+uint8_t lcd_refresh();
 
 /**
-* set window size
+* parser state for the status block
+*
+* @return: bit 7 = Fahrenheit, bit 6 = burst in progress, bits 0-1 = 1 pattern / 2 window prompt
+*/
+uint8_t lcd_mode();
+
+/**
+* set a row of the screen buffer, padded with spaces
+* 
+* @param row: 0 = top, 1 = bottom
+* @param str: up to 16 characters
+*/
+void lcd_put_row(uint8_t row, char *str);
+
+/**
+* set window size in the screen buffer
 * 
 * @param: byte of data (window size n)
 */
 void lcd_set_window_size(uint8_t data);
 
 /**
-* set temperature to the 3 digits that've been sent over
+* set temperature in the screen buffer from the last reading, in temp_unit
 */
 void lcd_set_temperature();
 
+/**
+* Celsius to Fahrenheit without float or division
+* 
+* @param tenths_c: 0.0-99.9 C in tenths
+* @return: tenths of a degree F, rounded
+*/
+uint16_t lcd_c_to_f(uint16_t tenths_c);
+
 /**
 * toggle cursor on lcd
 */
@@ -90,9 +129,4 @@ void lcd_toggle_blink();
 */ 
 void lcd_set_function();
 
-/**
-* clear line
-*/ 
-void lcd_clear_line(uint8_t cmd);
-
 #endif
@@ -8,23 +8,114 @@
 #include <msp430fr2310.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include "common/clock.h"
+#include "common/isr_share.h"
 
-uint8_t led_pattern = 0;
-uint8_t received_mode = 0;
-uint8_t data_recieved_count = 0;
-uint8_t data_received = 0;
-uint8_t write_pattern = 0;
-
-uint8_t patterns[3] = {128, 1, 0};
+volatile uint8_t led_pattern = 0;
+volatile uint8_t received_mode = 0;
+Events bar_events = 0;                  // DIRTY_ flags of finished writes, and EV_FRAME
 
 #define HEATING 2
 #define COOLING 1
 #define NEUTRAL 0
+#define CUSTOM  3
+#define MODES   4
+
+// Animations: one frame sequence per mode, kept in FRAM so uploads survive a reset
+#define MAX_FRAMES  8
+typedef struct {
+    uint8_t count;                      // frames played, 1-8
+    uint8_t frames[MAX_FRAMES];
+} Animation;
+
+#pragma PERSISTENT(animations)
+Animation animations[MODES] = {
+    {1, {0}},                                                   // NEUTRAL: off
+    {8, {0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x7F, 0xFF}},      // COOLING: fill left
+    {8, {0x80, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC, 0xFE, 0xFF}},      // HEATING: fill right
+    {1, {0}},                                                   // CUSTOM: off until uploaded
+};
+
+// I2C register map: first byte of a write sets the pointer, every byte after
+// it (or read back) moves the pointer on by one
+// 0x00-0x05 is the status block the controller polls
+#define BAR_MODE        0x00    // R/W: NEUTRAL, COOLING, HEATING or CUSTOM
+#define BAR_APPLIED     0x01    // R: writes taken since reset, counted at each STOP, wraps
+#define BAR_PERIOD      0x02    // R/W: frame period in 1/64 s, 1-127
+#define BAR_DROPPED     0x03    // R: bytes ignored (read-only or unknown register), stops at 255
+#define BAR_STATUS      0x04    // R: bit 7 = dimming active, bits 0-2 = frame shown
+#define BAR_VERSION     0x05    // R: major << 4 | minor
+#define BAR_ANIM        0x06    // R/W: animation the next registers read and write
+#define BAR_FRAME_COUNT 0x07    // R/W: frames in that animation, 1-8
+#define BAR_FRAME       0x08    // R/W: its 8 frames
+#define BAR_LEVEL       0x10    // R/W: brightness 0-7, one per LED
+#define BAR_REG_COUNT   0x18
+
+#define STATUS_DIMMING  BIT7
+#define FW_VERSION      0x13
+
+// what a write to each register changes, 0 = read only
+#define DIRTY_REGS      BIT0
+#define DIRTY_ANIM_SEL  BIT1
+#define DIRTY_ANIM      BIT2
+#define DIRTY_MASK      (DIRTY_REGS | DIRTY_ANIM_SEL | DIRTY_ANIM)
+#define EV_FRAME        BIT8            // the animation tick has a frame to show
+const uint8_t reg_dirty[BAR_REG_COUNT] = {
+    DIRTY_REGS, 0, DIRTY_REGS, 0, 0, 0, DIRTY_ANIM_SEL, DIRTY_ANIM,
+    DIRTY_ANIM, DIRTY_ANIM, DIRTY_ANIM, DIRTY_ANIM, DIRTY_ANIM, DIRTY_ANIM, DIRTY_ANIM, DIRTY_ANIM,
+    DIRTY_REGS, DIRTY_REGS, DIRTY_REGS, DIRTY_REGS, DIRTY_REGS, DIRTY_REGS, DIRTY_REGS, DIRTY_REGS
+};
+
+uint8_t bar_regs[BAR_REG_COUNT] = {
+    NEUTRAL, 0, 64, 0, 0, FW_VERSION, NEUTRAL, 1,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    7, 7, 7, 7, 7, 7, 7, 7
+};
+uint8_t *const led_level = &bar_regs[BAR_LEVEL];
+uint8_t bar_ptr = 0, bar_first = 0, bar_dirty = 0;
+const Animation *anim = &animations[NEUTRAL];  // animation being played
+uint8_t frame_idx = 0;
+
+// Timer B0 period in ACLK ticks, reloaded by the tick ISR so changes land on a frame boundary
+// Math: 1/64 s = (1/32768)(512)
+#define TICK_PERIOD_UNIT    512
+volatile uint16_t frame_ticks = (64 * TICK_PERIOD_UNIT) - 1;
+
+// LED bar wiring: P1.4-7 = bit 0-3, P1.1 = b4, P1.0 = b5, P2.7 = b6, P2.6 = b7
+#define BAR_P2_MASK (BIT7 | BIT6)
+#define BAR_P1(b)   ((((b) & BIT0) ? BIT4 : 0) | (((b) & BIT1) ? BIT5 : 0) | \
+                     (((b) & BIT2) ? BIT6 : 0) | (((b) & BIT3) ? BIT7 : 0) | \
+                     (((b) & BIT4) ? BIT1 : 0) | (((b) & BIT5) ? BIT0 : 0))
+#define BAR_P2(b)   ((((b) & BIT0) ? BIT7 : 0) | (((b) & BIT1) ? BIT6 : 0))
+#define ROW4(f, n)  f(n), f((n) + 1), f((n) + 2), f((n) + 3)
+#define ROW16(f, n) ROW4(f, n), ROW4(f, (n) + 4), ROW4(f, (n) + 8), ROW4(f, (n) + 12)
+
+// port values for every pattern, built at compile time: P1 from bits 0-5, P2 from bits 6-7
+const uint8_t bar_p1[64] = {
+    ROW16(BAR_P1, 0), ROW16(BAR_P1, 16), ROW16(BAR_P1, 32), ROW16(BAR_P1, 48)
+};
+const uint8_t bar_p2[4] = { ROW4(BAR_P2, 0) };
+
+// Brightness: binary-code modulation off Timer B1. Slot k shows bit k of each
+// LED's duty for 2^k units, so a 5-bit duty takes 5 slots per frame.
+#define BCM_BITS    5
+#define BCM_UNIT    2                       // ACLK ticks in the shortest slot (~61 us)
+const uint8_t bcm_ticks[BCM_BITS] = {BCM_UNIT, 2 * BCM_UNIT, 4 * BCM_UNIT, 8 * BCM_UNIT, 16 * BCM_UNIT};
+const uint8_t gamma_duty[8] = {0, 1, 2, 5, 9, 15, 22, 31};    // 8 levels, gamma 2.2
+
+// port values per slot, double buffered; the ISR picks up a new set at slot 0
+uint8_t bcm_p1[2][BCM_BITS], bcm_p2[2][BCM_BITS];
+volatile uint8_t bcm_front = 0, bcm_showing = 0;
+uint8_t bcm_slot = 0;
+
+void write_to_bar();
+void apply_regs(uint8_t changed);
 
 int main(void)
 {
     // Stop watchdog timer
     WDTCTL = WDTPW | WDTHOLD;
+    init_clock();
 
     // I2C Setup
 
@@ -49,21 +140,23 @@ int main(void)
     UCB0CTLW0 &= ~UCSWRST;
 
     // 5. Enable Interrupts
-    UCB0IE |= UCRXIE0;          // Enable I2C Rx0 IRQ
+    UCB0IE |= UCRXIE0 | UCTXIE0 | UCSTTIE | UCSTPIE;   // Rx, Tx, start and stop IRQs
 
-     // Timer B0
-    // Math: 1s = (1*10^-6)(D1)(D2)(25k)    D1 = 5, D2 = 8
+     // Timer B0 on ACLK (REFO) so it keeps running in LPM3
+    // Math: 1s = (1/32768)(32768)
     TB0CTL |= TBCLR;        // Clear timer and dividers
-    TB0CTL |= TBSSEL__SMCLK;  // Source = SMCLK
+    TB0CTL |= TBSSEL__ACLK;   // Source = ACLK
     TB0CTL |= MC__UP;       // Mode UP
-    TB0CTL |= ID__8;         // divide by 8 
-    TB0EX0 |= TBIDEX__5;    // divide by 5 (100)
 
-    TB0CCR0 = 25000;
+    TB0CCR0 = frame_ticks;
 
     TB0CCTL0 &= ~CCIFG;     // Clear CCR0
     TB0CCTL0 |= CCIE;       // Enable IRQ
 
+    // Timer B1: brightness modulation slots, continuous on ACLK, started by write_to_bar()
+    TB1CTL |= TBCLR;        // Clear timer and dividers
+    TB1CTL |= TBSSEL__ACLK;   // Source = ACLK
+
     // Port setup
     P1DIR |= 0b11110011;
     P2DIR |= 0b11000001;
@@ -79,99 +172,211 @@ int main(void)
 
     while (true)
     {
-        if (write_pattern){
+        // sleep in LPM3 until the animation tick or a finished write has a frame to show
+        __disable_interrupt();
+        if (!bar_events){
+            __bis_SR_register(LPM3_bits | GIE);
+            __disable_interrupt();
+        }
+        uint16_t events = events_take(&bar_events, DIRTY_MASK | EV_FRAME);
+        __enable_interrupt();
+
+        if (events & DIRTY_MASK){
+            apply_regs(events & DIRTY_MASK);
+        }
+
+        if (events & EV_FRAME){
             write_to_bar();
         }
     }
 }
 
 /**
-* Writes pattern to LED bar
+* Acts on a finished register write: new mode, period, levels or animation
+*
+* @param changed: DIRTY_ flags of the registers written
 */
-void write_to_bar()
+void apply_regs(uint8_t changed)
 {
-    // P1.4-7 = bit 0-3, P1.1 = b4, P1.0 = b5, P2.7 = b6, P2.6 = b7
-    if((BIT0 & led_pattern) == 0)   
-    {
-        P1OUT &= ~BIT4;
-    }
-    else
-    {
-        P1OUT |= BIT4;
-    }
-    if((BIT1 & led_pattern) == 0)
-    {
-        P1OUT &= ~BIT5;
-    }
-    else
-    {
-        P1OUT |= BIT5;
-    }
-    if((BIT2 & led_pattern) == 0)
-    {
-        P1OUT &= ~BIT6;
-    }
-    else
-    {
-        P1OUT |= BIT6;
-    }
-    if((BIT3 & led_pattern) == 0)
-    {
-        P1OUT &= ~BIT7;
-    }
-    else
-    {
-        P1OUT |= BIT7;
-    }
-    if((BIT4 & led_pattern) == 0)
+    uint8_t period = bar_regs[BAR_PERIOD];
+    period = (period == 0) ? 1 : (period > 127) ? 127 : period;
+    frame_ticks = ((uint16_t)period * TICK_PERIOD_UNIT) - 1;
+
+    uint8_t sel = bar_regs[BAR_ANIM] & (MODES - 1);
+    Animation *target = &animations[sel];
+    uint8_t i;
+
+    __disable_interrupt();                  // the tick ISR plays from the same tables
+    if(changed & DIRTY_ANIM)
     {
-        P1OUT &= ~BIT1;
+        // store the upload in FRAM
+        uint8_t count = bar_regs[BAR_FRAME_COUNT];
+        SYSCFG0 = FRWPPW | DFWP;            // program FRAM writable
+        target->count = (count == 0) ? 1 : (count > MAX_FRAMES) ? MAX_FRAMES : count;
+        for(i = 0; i < MAX_FRAMES; i++)
+        {
+            target->frames[i] = bar_regs[BAR_FRAME + i];
+        }
+        SYSCFG0 = FRWPPW | DFWP | PFWP;     // and protected again
     }
-    else
+    else if(changed & DIRTY_ANIM_SEL)
     {
-        P1OUT |= BIT1;
+        // load the selected animation so it can be read back
+        for(i = 0; i < MAX_FRAMES; i++)
+        {
+            bar_regs[BAR_FRAME + i] = target->frames[i];
+        }
     }
-    if((BIT5 & led_pattern) == 0)
+    bar_regs[BAR_FRAME_COUNT] = target->count;
+
+    uint8_t mode = bar_regs[BAR_MODE] & (MODES - 1);
+    if((mode != received_mode) || (frame_idx >= anim->count))
     {
-        P1OUT &= ~BIT0;
+        // show the new animation's first frame now rather than at the next tick
+        received_mode = mode;
+        anim = &animations[mode];
+        frame_idx = 0;
+        bar_regs[BAR_STATUS] &= STATUS_DIMMING;
     }
-    else
+    led_pattern = anim->frames[frame_idx];
+    __enable_interrupt();
+
+    write_to_bar();                         // levels may have changed
+}
+
+/**
+* Writes pattern to LED bar at each LED's brightness
+*
+* Fully on/off frames are written straight to the ports with Timer B1 stopped;
+* anything dimmer is split into bit planes for the modulation ISR.
+*/
+void write_to_bar()
+{
+    uint8_t pattern = led_pattern;
+    uint8_t planes[BCM_BITS] = {0};
+    uint8_t i, k;
+
+    for(i = 0; i < 8; i++)
     {
-        P1OUT |= BIT0;
+        if(pattern & (1 << i))
+        {
+            uint8_t duty = gamma_duty[led_level[i] & 0x07];
+            for(k = 0; k < BCM_BITS; k++)
+            {
+                if(duty & (1 << k))
+                {
+                    planes[k] |= 1 << i;
+                }
+            }
+        }
     }
-    if((BIT6 & led_pattern) == 0)
+
+    uint8_t uniform = 1;
+    for(k = 1; k < BCM_BITS; k++)
     {
-        P2OUT &= ~BIT7;
+        if(planes[k] != planes[0])
+        {
+            uniform = 0;
+        }
     }
-    else
+
+    unsigned short int_state = __get_interrupt_state();
+    if(uniform)
     {
-        P2OUT |= BIT7;
+        __disable_interrupt();              // P2.0 is the heartbeat LED, toggled from the timer ISR
+        TB1CCTL0 &= ~CCIE;                  // no modulation needed
+        TB1CTL &= ~MC;
+        bar_regs[BAR_STATUS] &= ~STATUS_DIMMING;
+        P1OUT = bar_p1[planes[0] & 0x3F];   // P1 only carries bar LEDs and I2C
+        P2OUT = (P2OUT & ~BAR_P2_MASK) | bar_p2[planes[0] >> 6];
+        __set_interrupt_state(int_state);
+        return;
     }
-    if((BIT7 & led_pattern) == 0)
+
+    uint8_t back = bcm_showing ^ 1;         // never the set on the LEDs right now
+    for(k = 0; k < BCM_BITS; k++)
     {
-        P2OUT &= ~BIT6;
+        bcm_p1[back][k] = bar_p1[planes[k] & 0x3F];
+        bcm_p2[back][k] = bar_p2[planes[k] >> 6];
     }
-    else
+    bcm_front = back;
+    bar_regs[BAR_STATUS] |= STATUS_DIMMING;
+
+    if(!(TB1CCTL0 & CCIE))
     {
-        P2OUT |= BIT6;
+        __disable_interrupt();
+        bcm_slot = 0;
+        TB1CCR0 = TB1R + BCM_UNIT;
+        TB1CCTL0 &= ~CCIFG;
+        TB1CCTL0 |= CCIE;
+        TB1CTL |= MC__CONTINUOUS;
+        __set_interrupt_state(int_state);
     }
-    
 }
 
 
 //-- Interrupt Service Routines -----------------------
 
 /**
-* receiveData
+* receiveData: register reads and writes with pointer auto-increment
 */
 #pragma vector = EUSCI_B0_VECTOR
 __interrupt void receive_data(void)
 {
     switch(UCB0IV)             // determines which IFG has been triggered
     {
+    case USCI_I2C_UCSTTIFG:                 // ID 0x06: addressed, next written byte is the pointer
+        bar_first = 1;
+        break;
+    case USCI_I2C_UCSTPIFG:                 // ID 0x08: apply a write as a whole
+        if(bar_dirty)
+        {
+            bar_regs[BAR_APPLIED]++;        // per write: main may take several in one pass
+            events_post(&bar_events, bar_dirty);
+            bar_dirty = 0;
+            __bic_SR_register_on_exit(LPM3_bits);
+        }
+        break;
     case USCI_I2C_UCRXIFG0:                 // ID 0x16: Rx IFG
-        data_received = 1;
-        received_mode = UCB0RXBUF;    // retrieve mode
+    {
+        uint8_t data = UCB0RXBUF;
+        if(bar_first)
+        {
+            bar_first = 0;
+            bar_ptr = 0;
+            if(data < BAR_REG_COUNT)
+            {
+                bar_ptr = data;
+            }
+            else if(bar_regs[BAR_DROPPED] != 0xFF)
+            {
+                bar_regs[BAR_DROPPED]++;    // unknown register, carry on from 0
+            }
+            break;
+        }
+        uint8_t dirty = reg_dirty[bar_ptr];
+        if(dirty)
+        {
+            bar_regs[bar_ptr] = data;
+            bar_dirty |= dirty;
+        }
+        else if(bar_regs[BAR_DROPPED] != 0xFF)
+        {
+            bar_regs[BAR_DROPPED]++;        // read only
+        }
+        if(++bar_ptr == BAR_REG_COUNT)
+        {
+            bar_ptr = 0;
+        }
+        break;
+    }
+    case USCI_I2C_UCTXIFG0:                 // ID 0x18: Tx IFG
+        bar_first = 0;
+        UCB0TXBUF = bar_regs[bar_ptr];
+        if(++bar_ptr == BAR_REG_COUNT)
+        {
+            bar_ptr = 0;
+        }
         break;
     default:
         break;
@@ -187,55 +392,60 @@ __interrupt void receive_data(void)
 __interrupt void heartbeat_LED(void)
 {
     P2OUT ^= BIT0;          // P2.0 xOR
-    if(data_received != 0)
-    {
-        // Math: .2s = (1*10^-6)(D1)(D2)(5k)    D1 = 5, D2 = 8
-        TB0CCR0 = 5000;
-        data_recieved_count++;
-        
-        if(data_recieved_count == 10)
-        {
-            data_received = 0;
-            data_recieved_count = 0;
-            TB0CCR0 = 25000;
-        }
-    }
+    TB0CCR0 = frame_ticks;  // counter just wrapped, safe to change the period
 
-    // getting binary code for current light pattern
-    switch (received_mode) {
-        case HEATING:
-            // fill right
-            if(patterns[0] == 0b11111111)
-            {
-                patterns[0] = 0b10000000;
-            }
-            else 
-            {
-                patterns[0] >>= 1; 
-                patterns[0] |= BIT7;   
-            }
-            led_pattern = patterns[0];
-            break;
-        case COOLING:
-            // fill left
-            if(patterns[1] == 0b11111111)
-            {
-                patterns[1] = 0b00000001;
-            }
-            else 
-            {
-                patterns[1] <<= 1; 
-                patterns[1] += 1;   
-            }
-            led_pattern = patterns[1];
-            break;
-        default:
-            // no light
-            led_pattern = patterns[2];
+    // next frame of the current animation
+    if(++frame_idx >= anim->count)
+    {
+        frame_idx = 0;
     }
+    led_pattern = anim->frames[frame_idx];
+    bar_regs[BAR_STATUS] = (bar_regs[BAR_STATUS] & STATUS_DIMMING) | frame_idx;
 
-    write_pattern = 1;
+    events_post(&bar_events, EV_FRAME);
 
     TB0CCTL0 &= ~CCIFG;     // clear flag
+    __bic_SR_register_on_exit(LPM3_bits);   // wake main to write the frame
 }
 // ----- end heartbeatLED-----
+
+/**
+* TB1R, read until two reads agree: it counts on ACLK, not MCLK
+*/
+static inline uint16_t bcm_count()
+{
+    uint16_t a, b = TB1R;
+    do
+    {
+        a = b;
+        b = TB1R;
+    } while(a != b);
+    return a;
+}
+
+/**
+* Brightness modulation: show one bit plane and schedule the next slot
+*/
+#pragma vector = TIMER1_B0_VECTOR
+__interrupt void bcm_slot_done(void)
+{
+    if(bcm_slot == 0)
+    {
+        bcm_showing = bcm_front;            // only swap frames between full cycles
+    }
+    P1OUT = bcm_p1[bcm_showing][bcm_slot];
+    P2OUT = (P2OUT & ~BAR_P2_MASK) | bcm_p2[bcm_showing][bcm_slot];
+
+    uint16_t next = TB1CCR0 + bcm_ticks[bcm_slot];
+    uint16_t now = bcm_count();
+    if((int16_t)(next - now) <= 0)
+    {
+        next = now + bcm_ticks[bcm_slot];   // held past it by another ISR: from now, not after TB1R wraps
+    }
+    TB1CCR0 = next;
+    if(++bcm_slot == BCM_BITS)
+    {
+        bcm_slot = 0;
+    }
+}
+// ----- end bcm_slot_done-----